@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "utils/buffer/buffer.hpp"
+#include "utils/device/device.hpp"
+#include "utils/entity/entity.hpp"
+#include "utils/entity/prefab.hpp"
+#include "utils/math/transformkernel.hpp"
+#include "utils/window/window.hpp"
+
+// Micro benchmarks of the engine's hot CPU paths, each one prints its own results. Every measurement is the best of
+// RUNS runs, so a cold cache or a context switch doesn't skew it.
+namespace {
+    using namespace Engine;
+
+    constexpr int RUNS = 10;
+    constexpr size_t ENTITY_COUNT = 100'000;
+
+    volatile float sink; // Keeps the optimizer from dropping the work
+
+    template<typename Func>
+    double bestOf(int runs, Func &&func) {
+        double best = 1e30;
+        for (int i = 0; i < runs; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() < best) best = elapsed.count();
+        } return best;
+    }
+
+    void printResult(const char *name, double seconds, size_t count) {
+        std::printf("  %-34s %9.3f ms %8.2f ns/item\n", name, seconds * 1e3, seconds * 1e9 / static_cast<double>(count));
+    }
+
+    // Walking the archetype columns of a view, against looking every entity up by id, once per frame
+    void benchEntities(size_t count) {
+        std::printf("entities: %zu with a transform and a model, as many with a transform only\n", count);
+
+        Registry registry;
+        std::vector<Entity::id_t> ids(count);
+        registry.createEntities<TransformComponent, ModelComponent>(count, [](size_t i, TransformComponent *transform,
+                                                                              ModelComponent *model) {
+            new (transform) TransformComponent(glm::vec3{static_cast<float>(i), 0.0f, 0.0f});
+            new (model) ModelComponent(nullptr);
+        }, ids.data());
+        registry.createEntities<TransformComponent>(count, [](size_t i, TransformComponent *transform) {
+            new (transform) TransformComponent(glm::vec3{static_cast<float>(i), 0.0f, 0.0f});
+        });
+
+        const auto view = registry.view<TransformComponent, ModelComponent>();
+        printResult("view each", bestOf(RUNS, [&] {
+            float sum = 0.0f;
+            view.each([&](TransformComponent &transform, ModelComponent &) { sum += transform.getPosition().x; });
+            sink = sum;
+        }), count);
+        printResult("lookup by id", bestOf(RUNS, [&] {
+            float sum = 0.0f;
+            for (Entity::id_t id : ids) sum += registry.getEntity(id).getComponent<TransformComponent>().getPosition().x;
+            sink = sum;
+        }), count);
+    }
+
+    // How the cost scales, from what fits in cache to what doesn't
+    void benchEntityCounts() {
+        for (size_t count : {size_t{10'000}, size_t{100'000}, size_t{1'000'000}}) benchEntities(count);
+    }
+
+    // Spawning entities sharing a model in bulk, against one at a time. Every run starts from an empty registry, only
+    // the spawning is timed
+    void benchSpawn() {
+        std::printf("spawn: %zu entities with a transform and a model\n", ENTITY_COUNT);
+
+        std::vector<Prefab::Instance> instances(ENTITY_COUNT);
+        for (size_t i = 0; i < ENTITY_COUNT; i++) instances[i].position = {static_cast<float>(i), 0.0f, 0.0f};
+        const Prefab prefab{nullptr};
+
+        const auto bestSpawn = [](auto &&spawn) {
+            double best = 1e30;
+            for (int i = 0; i < RUNS; i++) {
+                auto registry = std::make_unique<Registry>();
+                best = std::min(best, bestOf(1, [&] { spawn(*registry); }));
+            } return best;
+        };
+        printResult("Prefab::spawn", bestSpawn([&](Registry &registry) { prefab.spawn(registry, instances); }), ENTITY_COUNT);
+        printResult("createEntity + addComponent", bestSpawn([&](Registry &registry) {
+            for (const Prefab::Instance &instance : instances) {
+                Entity entity = registry.createEntity();
+                entity.addComponent<TransformComponent>(instance.position, instance.scale, instance.rotation);
+                entity.addComponent<ModelComponent>(prefab.getModel(), prefab.getTextureIndex());
+            }
+        }), ENTITY_COUNT);
+    }
+
+    // Every path of the batched matrix kernel, and how far each strays from TransformComponent's own math
+    void benchTransforms() {
+        std::printf("transforms: %zu, this CPU picks %s\n",
+                    ENTITY_COUNT,
+                    TransformKernel::getPathName(TransformKernel::getActivePath()));
+
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> position{-100.0f, 100.0f}, angle{-6.3f, 6.3f}, scale{0.1f, 4.0f};
+        std::vector<float> values(9 * ENTITY_COUNT);
+        for (size_t i = 0; i < ENTITY_COUNT; i++) {
+            for (size_t axis = 0; axis < 3; axis++) {
+                values[axis * ENTITY_COUNT + i] = position(random);
+                values[(3 + axis) * ENTITY_COUNT + i] = angle(random);
+                values[(6 + axis) * ENTITY_COUNT + i] = scale(random);
+            }
+        }
+        const auto array = [&](size_t index) { return values.data() + index * ENTITY_COUNT; };
+        const TransformKernel::TransformArrays arrays{array(0), array(1), array(2),
+                                                      array(3), array(4), array(5),
+                                                      array(6), array(7), array(8)};
+
+        std::vector<TransformComponent::Pose> poses(ENTITY_COUNT);
+        for (size_t i = 0; i < ENTITY_COUNT; i++)
+            poses[i] = {{arrays.positionX[i], arrays.positionY[i], arrays.positionZ[i]},
+                        {arrays.scaleX[i], arrays.scaleY[i], arrays.scaleZ[i]},
+                        {arrays.rotationX[i], arrays.rotationY[i], arrays.rotationZ[i]}};
+
+        // The glm translate, rotate and scale path every transform used to go through on its own, the baseline
+        std::vector<glm::mat4> expectedModels(ENTITY_COUNT);
+        std::vector<glm::mat3> expectedNormals(ENTITY_COUNT);
+        printResult("per entity glm", bestOf(RUNS, [&] {
+            for (size_t i = 0; i < ENTITY_COUNT; i++) {
+                expectedModels[i] = TransformComponent::computeMat4(poses[i]);
+                expectedNormals[i] = TransformComponent::computeNormal(poses[i]);
+            }
+        }), ENTITY_COUNT);
+
+        std::vector<glm::mat4> models(ENTITY_COUNT);
+        std::vector<glm::mat3> normals(ENTITY_COUNT);
+        for (TransformKernel::Path path : {TransformKernel::Path::SCALAR,
+                                           TransformKernel::Path::SSE2,
+                                           TransformKernel::Path::AVX2}) {
+            const double seconds = bestOf(RUNS, [&] {
+                TransformKernel::computeMatrices(path, arrays, ENTITY_COUNT, models.data(), normals.data());
+            });
+
+            float deviation = 0.0f;
+            for (size_t i = 0; i < ENTITY_COUNT; i++) {
+                const glm::mat4 &model = expectedModels[i];
+                const glm::mat3 &normal = expectedNormals[i];
+                for (int column = 0; column < 3; column++) {
+                    for (int row = 0; row < 3; row++) {
+                        deviation = std::max(deviation, std::abs(models[i][column][row] - model[column][row]));
+                        deviation = std::max(deviation, std::abs(normals[i][column][row] - normal[column][row]));
+                    }
+                } for (int row = 0; row < 3; row++) deviation = std::max(deviation, std::abs(models[i][3][row] - model[3][row]));
+            }
+
+            // Named after the path that ran, an unsupported one falls back to a narrower one
+            char name[64];
+            const TransformKernel::Path taken = TransformKernel::resolvePath(path);
+            if (taken == path) std::snprintf(name, sizeof(name), "kernel %s", TransformKernel::getPathName(path));
+            else std::snprintf(name, sizeof(name), "kernel %s (unsupported, ran %s)",
+                               TransformKernel::getPathName(path), TransformKernel::getPathName(taken));
+            printResult(name, seconds, ENTITY_COUNT);
+            std::printf("  %-34s %9.2e\n", "  max deviation", static_cast<double>(deviation));
+        }
+    }
+
+    // Filling a buffer the GPU reads from through a mapping of device local memory (ReBAR), against staging it and
+    // waiting for the copy. Each run creates its buffer, like Model::createStaticBuffer does, and ends once the GPU
+    // could read the data. Needs a GPU, so it only runs when asked for
+    void benchUpload() {
+        Window window{800, 600, "Benchmarks"};
+        Device device{window};
+        constexpr VkBufferUsageFlags USAGE = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        for (VkDeviceSize size : {VkDeviceSize{64} << 10, VkDeviceSize{1} << 20, VkDeviceSize{4} << 20}) {
+            std::printf("upload: %llu KiB\n", static_cast<unsigned long long>(size >> 10));
+            std::vector<char> data(size, 1);
+
+            bool hostVisible = true;
+            const double direct = bestOf(RUNS, [&] {
+                Buffer buffer{device, size, 1, USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+                hostVisible = buffer.isHostVisible();
+                if (!hostVisible) return;
+                buffer.map();
+                buffer.writeToBuffer(data.data());
+                buffer.unmap();
+            });
+            if (hostVisible) printResult("direct write", direct, size);
+            else std::printf("  %-34s\n", "direct write: no host visible device local memory");
+
+            UploadManager &uploadManager = device.getUploadManager();
+            printResult("staging", bestOf(RUNS, [&] {
+                Buffer buffer{device, size, 1, USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+                uploadManager.wait(uploadManager.uploadBuffer(buffer.getBuffer(), data.data(), size));
+            }), size);
+        }
+    }
+
+    struct Benchmark {
+        const char *name;
+        void (*run)();
+        bool cpuOnly; // Runs by default, the others need a GPU and are only run when asked for
+    };
+
+    constexpr Benchmark BENCHMARKS[] = {
+        {"entities", benchEntityCounts, true},
+        {"spawn", benchSpawn, true},
+        {"transforms", benchTransforms, true},
+        {"upload", benchUpload, false},
+    };
+}
+
+int main(int argc, char **argv) {
+    try {
+        for (const Benchmark &benchmark : BENCHMARKS) {
+            bool selected = argc == 1 && benchmark.cpuOnly;
+            for (int i = 1; i < argc; i++) selected |= std::strcmp(argv[i], benchmark.name) == 0;
+            if (selected) benchmark.run();
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    } return EXIT_SUCCESS;
+}
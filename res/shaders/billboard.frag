@@ -1,10 +1,5 @@
 #version 460
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
 layout (set = 0, binding = 0) uniform GlobalUbo {
     mat4 viewMatrix;
     mat4 projMatrix;
@@ -12,21 +7,16 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
 
     vec4 ambientLightColor;
 
-    PointLight pointLights[8];
-    int pointLightCount;
+    vec4 clusterParams; // x, y = clusters per pixel, z = depth slice scale, w = depth slice bias
+    uvec4 clusterGrid; // x, y, z = clusters along each axis, w = light count
 } globalUbo;
 
-layout (push_constant) uniform PushConstants {
-    vec4 position;
-    vec4 color;
-    float radius;
-} push;
-
 layout (location = 0) in vec2 fragOffset;
+layout (location = 1) flat in vec3 fragColor;
 
 layout (location = 0) out vec4 outColor;
 
 void main() {
     if(sqrt(dot(fragOffset, fragOffset)) >= 1.0) discard;
-    outColor = vec4(push.color.rgb, 1.0);
+    outColor = vec4(fragColor, 1.0);
 }
\ No newline at end of file
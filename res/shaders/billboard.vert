@@ -9,11 +9,6 @@ const float offsets[12] = {
     0.5, 0.5,
 };
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
 layout (set = 0, binding = 0) uniform GlobalUbo {
     mat4 viewMatrix;
     mat4 projMatrix;
@@ -21,26 +16,34 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
 
     vec4 ambientLightColor;
 
-    PointLight pointLights[8];
-    int pointLightCount;
+    vec4 clusterParams; // x, y = clusters per pixel, z = depth slice scale, w = depth slice bias
+    uvec4 clusterGrid; // x, y, z = clusters along each axis, w = light count
 } globalUbo;
 
-layout (push_constant) uniform PushConstants {
-    vec4 position;
-    vec4 color;
-    float radius;
-} push;
+struct BillboardData {
+    vec4 position; // w = radius
+    vec4 color; // w = intensity
+};
+
+// Every light of the frame, written by BillboardRenderSystem::update, one instance each
+layout (std430, set = 1, binding = 0) readonly buffer BillboardBuffer {
+    BillboardData billboards[];
+} billboardBuffer;
 
 layout (location = 0) out vec2 fragOffset;
+layout (location = 1) flat out vec3 fragColor;
 
 void main() {
+    BillboardData billboard = billboardBuffer.billboards[gl_InstanceIndex];
+
     fragOffset = vec2(offsets[gl_VertexIndex * 2], offsets[gl_VertexIndex * 2 + 1]);
+    fragColor = billboard.color.rgb;
     vec3 cameraRightWorld = {globalUbo.viewMatrix[0][0], globalUbo.viewMatrix[1][0], globalUbo.viewMatrix[2][0]};
     vec3 cameraUpWorld = {globalUbo.viewMatrix[0][1], globalUbo.viewMatrix[1][1], globalUbo.viewMatrix[2][1]};
 
-    vec3 posWorld = push.position.xyz
-    + push.radius * fragOffset.x * cameraRightWorld
-    + push.radius * fragOffset.y * cameraUpWorld;
+    vec3 posWorld = billboard.position.xyz
+    + billboard.position.w * fragOffset.x * cameraRightWorld
+    + billboard.position.w * fragOffset.y * cameraUpWorld;
 
     gl_Position = globalUbo.projMatrix * (globalUbo.viewMatrix * vec4(posWorld, 1.0));
 }
\ No newline at end of file
@@ -1,9 +1,5 @@
 #version 460
-
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (set = 0, binding = 0) uniform GlobalUbo {
     mat4 viewMatrix;
@@ -12,24 +8,46 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
 
     vec4 ambientLightColor;
 
-    PointLight pointLights[8];
-    int pointLightCount;
+    vec4 clusterParams; // x, y = clusters per pixel, z = depth slice scale, w = depth slice bias
+    uvec4 clusterGrid; // x, y, z = clusters along each axis, w = light count
 } globalUbo;
 
-layout(set = 0, binding = 1) uniform sampler2D texSampler;
+struct LightData {
+    vec4 position; // w = radius
+    vec4 color; // w = intensity
+};
+
+struct ClusterData {
+    uint offset;
+    uint count;
+};
+
+// Filled every frame by LightClusterSystem, each cluster lists the lights reaching into it
+layout (std430, set = 3, binding = 0) readonly buffer LightBuffer { LightData lights[]; };
+layout (std430, set = 3, binding = 1) readonly buffer ClusterBuffer { ClusterData clusters[]; };
+layout (std430, set = 3, binding = 2) readonly buffer LightIndexBuffer { uint lightIndices[]; };
 
-layout (push_constant) uniform PushConstant {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
+// Bindless texture table (see TextureTable), only the slots that have been registered are valid
+layout(set = 2, binding = 0) uniform sampler2D textures[];
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPos;
 layout (location = 2) in vec3 fragNormal;
 layout (location = 3) in vec2 fragTexCoords;
+layout (location = 4) flat in uint fragTextureIndex;
+layout (location = 5) in float fragViewDepth;
 
 layout (location = 0) out vec4 outColor;
 
+// Screen tile from the pixel, depth slice from the log of the view depth, see LightClusterSystem::update
+uint clusterIndex() {
+    uvec3 grid = globalUbo.clusterGrid.xyz;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * globalUbo.clusterParams.xy), grid.xy - 1);
+    float slice = log(max(fragViewDepth, 1e-4)) * globalUbo.clusterParams.z + globalUbo.clusterParams.w;
+    uint depthSlice = uint(clamp(slice, 0.0, float(grid.z - 1)));
+    return (depthSlice * grid.y + tile.y) * grid.x + tile.x;
+}
+
 void main() {
     vec3 diffuse = globalUbo.ambientLightColor.rgb * globalUbo.ambientLightColor.a;
     vec3 specular = vec3(0.0);
@@ -38,10 +56,16 @@ void main() {
     vec3 cameraPosWorld = globalUbo.inverseViewMatrix[3].xyz;
     vec3 viewDir = normalize(cameraPosWorld - fragPos);
 
-    for(int i = 0; i < globalUbo.pointLightCount; i++) {
-        PointLight light = globalUbo.pointLights[i];
+    ClusterData cluster = clusters[clusterIndex()];
+    for(uint i = 0; i < cluster.count; i++) {
+        LightData light = lights[lightIndices[cluster.offset + i]];
         vec3 directionToLight = light.position.xyz - fragPos;
-        float attenuation = 1.0 / dot(directionToLight, directionToLight); // distance squared
+        float distanceSquared = dot(directionToLight, directionToLight);
+
+        // Inverse square, windowed so it reaches exactly zero at the radius of the light
+        float falloff = distanceSquared / (light.position.w * light.position.w);
+        float window = clamp(1.0 - falloff * falloff, 0.0, 1.0);
+        float attenuation = window * window / distanceSquared;
 
         directionToLight = normalize(directionToLight);
 
@@ -57,5 +81,5 @@ void main() {
     }
 
     //TODO(Dory): Make it so that you can choose if there's mettallic highlights or not
-    outColor = texture(texSampler, fragTexCoords) * vec4(diffuse * fragColor + specular * fragColor, 1.0);
+    outColor = texture(textures[nonuniformEXT(fragTextureIndex)], fragTexCoords) * vec4(diffuse * fragColor + specular * fragColor, 1.0);
 }
\ No newline at end of file
@@ -1,10 +1,5 @@
 #version 460
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
 layout (set = 0, binding = 0) uniform GlobalUbo {
     mat4 viewMatrix;
     mat4 projMatrix;
@@ -12,14 +7,24 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
 
     vec4 ambientLightColor;
 
-    PointLight pointLights[8];
-    int pointLightCount;
+    vec4 clusterParams; // x, y = clusters per pixel, z = depth slice scale, w = depth slice bias
+    uvec4 clusterGrid; // x, y, z = clusters along each axis, w = light count
 } globalUbo;
 
-layout (push_constant) uniform PushConstant {
+struct InstanceData {
     mat4 modelMatrix;
     mat4 normalMatrix;
-} push;
+    uint batchIndex;
+    uint textureIndex;
+    uint padding0;
+    uint padding1;
+};
+
+// Written every frame by SimpleRenderSystem, entities sharing a model are drawn as consecutive instances
+// On the GPU driven path these are only the instances that survived culling (see cull.comp)
+layout (std430, set = 1, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceBuffer;
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 color;
@@ -30,15 +35,22 @@ layout (location = 0) out vec3 fragColor;
 layout (location = 1) out vec3 fragPos;
 layout (location = 2) out vec3 fragNormal;
 layout (location = 3) out vec2 fragTexCoord;
+layout (location = 4) flat out uint fragTextureIndex;
+layout (location = 5) out float fragViewDepth;
 
 void main() {
-    vec4 worldPos = push.modelMatrix * vec4(position, 1.0);
-    gl_Position = globalUbo.viewMatrix * (globalUbo.projMatrix * worldPos);
+    InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+
+    vec4 worldPos = instance.modelMatrix * vec4(position, 1.0);
+    vec4 viewPos = globalUbo.projMatrix * worldPos; // The ubo names the view and projection matrices the other way around
+    gl_Position = globalUbo.viewMatrix * viewPos;
 
     fragPos = worldPos.xyz;
-    fragNormal = normalize(mat3(push.normalMatrix) * normal);
+    fragNormal = normalize(mat3(instance.normalMatrix) * normal);
+    fragViewDepth = viewPos.z;
 
     fragColor = color;
 
     fragTexCoord = vec2(texCoord.x, -texCoord.y); // IDK why but it works
+    fragTextureIndex = instance.textureIndex;
 }
\ No newline at end of file
@@ -5,9 +5,9 @@ namespace Engine {
         globalPool = DescriptorPool::Builder(device)
                      .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
                      .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
-                     .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT)
                      .build();
         loadEntities();
+        device.getUploadManager().waitIdle(); // Nothing is streamed yet, the first frame needs the whole scene
     }
     Application::~Application() {
         globalPool = nullptr; // We need globalPool to be destroyed before device is, this ensures that happens.
@@ -21,42 +21,110 @@ namespace Engine {
                     sizeof(GlobalUbo),
                     1,
                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    1,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
             uboBuffer->map();
         }
 
         auto globalSetLayout = DescriptorSetLayout::Builder(device)
                 .addBinding(0,
                             VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-                .addBinding(1,
-                            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                            VK_SHADER_STAGE_FRAGMENT_BIT).build();
-
-        Texture texture{device, "../res/textures/texture.jpg"};
+                            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT).build();
 
         std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
         for (unsigned int i = 0; i < globalDescriptorSets.size(); i++) {
             VkDescriptorBufferInfo bufferInfo = uboBuffers[i]->descriptorInfo();
-            VkDescriptorImageInfo imageInfo = texture.getDescriptorImageInfo();
             DescriptorWriter(*globalSetLayout, *globalPool)
                 .writeBuffer(0, &bufferInfo)
-                .writeImage(1, &imageInfo)
                 .build(globalDescriptorSets[i]);
         }
 
+        LightClusterSystem lightClusterSystem{device, threadPool};
         SimpleRenderSystem simpleRenderSystem{device,
                                               renderer.getSwapChainRenderPass(),
-                                              globalSetLayout->getDescriptorSetLayout()};
+                                              globalSetLayout->getDescriptorSetLayout(),
+                                              textureTable,
+                                              lightClusterSystem,
+                                              residencyManager};
         BillboardRenderSystem billboardRenderSystem{device,
                                                     renderer.getSwapChainRenderPass(),
                                                     globalSetLayout->getDescriptorSetLayout()};
         Camera camera{};
         camera.setViewTarget(glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{0.5f, 0.0f, 1.0f});
 
-        auto cameraEntity = Entity::createEntity();
-        cameraEntity.addComponent(std::make_unique<TransformComponent>(glm::vec3{0.0f, 0.0f, -2.5f}));
+        Entity cameraEntity = registry.createEntity();
+        cameraEntity.addComponent<TransformComponent>(glm::vec3{0.0f, 0.0f, -2.5f});
         KeyboardMovementController cameraController{};
+        TransformSystem transformSystem{threadPool};
+        CullingSystem cullingSystem{threadPool};
+
+        // Systems run in parallel whenever their component accesses don't overlap (see SystemScheduler)
+        // The simulation runs at a fixed rate, zero or more times per frame, everything else once per frame
+        SystemScheduler simulation{threadPool};
+        simulation.addSystem({"Input", 0, componentMask<TransformComponent>(), true}, [&](FrameInfo &stepInfo) {
+            cameraController.moveInPlaneXZ(window.getWindow(), stepInfo.frameTime, cameraEntity);
+        });
+
+        GlobalUbo ubo{};
+        SystemScheduler scheduler{threadPool};
+        scheduler.addSystem({"Transforms", componentMask<HierarchyComponent>(), componentMask<TransformComponent>()},
+                            [&](FrameInfo &frameInfo) { transformSystem.update(registry, frameInfo.interpolationAlpha); });
+        const auto cameraSystem = scheduler.addSystem({"Camera", componentMask<TransformComponent>()}, [&](FrameInfo &frameInfo) {
+            const auto pose = cameraEntity.getTransformComponent()->interpolate(frameInfo.interpolationAlpha);
+            camera.setViewXYZ(pose.position, pose.rotation);
+
+            float aspectRatio = renderer.getAspectRatio();
+            // camera.setOrthographicProjection(aspectRatio, -1.0f, -1.0f, 1.0f);
+            // camera.setOrthographicProjection(-aspectRatio, aspectRatio, -1.0f, 1.0f, -1.0f, 1.0f);
+            camera.setPerspectiveProjection(FOV, aspectRatio, NEAR_PLANE, FAR_PLANE);
+
+            ubo.projectionMatrix = frameInfo.camera.getProjectionMatrix();
+            ubo.viewMatrix = frameInfo.camera.getViewMatrix();
+            ubo.inverseViewMatrix = frameInfo.camera.getInverseViewMatrix();
+        });
+        // Only touches the cluster fields of the ubo, but assigns lights to clusters in view space, so it needs the camera
+        const auto lightSystem = scheduler.addSystem({"Lights",
+                                                      componentMask<TransformComponent, PointLightComponent>(),
+                                                      0,
+                                                      false,
+                                                      {cameraSystem}}, [&](FrameInfo &frameInfo) {
+            billboardRenderSystem.update(frameInfo);
+            lightClusterSystem.update(frameInfo, ubo, renderer.getSwapChainExtent());
+        });
+        // GPU driven rendering culls in a compute pass, the CPU one is only needed for the fallback path.
+        // It writes the visibility flags of the models, so it always runs before Render.
+        if (!simpleRenderSystem.isGpuDriven())
+            scheduler.addSystem({"Culling", componentMask<TransformComponent>(), componentMask<ModelComponent>(), false, {cameraSystem}},
+                                [&](FrameInfo &frameInfo) { cullingSystem.update(frameInfo.registry, frameInfo.camera); });
+        scheduler.addSystem({"Render",
+                             componentMask<TransformComponent, ModelComponent, PointLightComponent>(),
+                             0,
+                             false,
+                             {cameraSystem, lightSystem}}, [&](FrameInfo &frameInfo) {
+            uboBuffers[frameInfo.frameIndex]->writeToBuffer(&ubo);
+            uboBuffers[frameInfo.frameIndex]->flush();
+
+            simpleRenderSystem.prepare(frameInfo); // May record compute work, so it goes before the render pass
+
+            // Draws are recorded into secondary command buffers, split across the thread pool
+            renderer.beginSwapChainRenderPass(frameInfo.commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            renderer.recordSecondary(frameInfo.commandBuffer,
+                                     threadPool,
+                                     simpleRenderSystem.getBatchCount(),
+                                     SimpleRenderSystem::MIN_BATCHES_PER_SLICE,
+                                     [&](VkCommandBuffer commandBuffer, size_t begin, size_t end) {
+                FrameInfo sliceInfo{frameInfo};
+                sliceInfo.commandBuffer = commandBuffer;
+                simpleRenderSystem.renderGameObjects(sliceInfo, begin, end);
+            });
+            renderer.recordSecondary(frameInfo.commandBuffer, threadPool, 1, 1, [&](VkCommandBuffer commandBuffer, size_t, size_t) {
+                FrameInfo sliceInfo{frameInfo};
+                sliceInfo.commandBuffer = commandBuffer;
+                billboardRenderSystem.render(sliceInfo);
+            });
+            renderer.endSwapChainRenderPass(frameInfo.commandBuffer);
+        });
 
         auto currentTime = std::chrono::high_resolution_clock::now();
         while (!window.shouldClose()) {
@@ -66,87 +134,81 @@ namespace Engine {
             float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             currentTime = newTime;
 
-            deltaTime = glm::min(deltaTime, FrameInfo::MAX_DELTA_TIME);
-
-            cameraController.moveInPlaneXZ(window.getWindow(), deltaTime, cameraEntity);
-            camera.setViewXYZ(cameraEntity.getTransformComponent()->position,
-                              cameraEntity.getTransformComponent()->rotation);
+            const uint32_t steps = timestep.advance(deltaTime);
+            for (uint32_t step = 0; step < steps; step++) {
+                FrameInfo stepInfo{0, // Not rendering anything, so no frame index, command buffer nor descriptor set
+                                   timestep.getStep(),
+                                   VK_NULL_HANDLE,
+                                   camera,
+                                   VK_NULL_HANDLE,
+                                   registry,
+                                   entityCommands};
+
+                transformSystem.beginStep(registry);
+                simulation.run(stepInfo);
+                entityCommands.playback(registry); // Sync point, no system is running anymore
+            }
 
-            float aspectRatio = renderer.getAspectRatio();
-            // camera.setOrthographicProjection(aspectRatio, -1.0f, -1.0f, 1.0f);
-            // camera.setOrthographicProjection(-aspectRatio, aspectRatio, -1.0f, 1.0f, -1.0f, 1.0f);
-            camera.setPerspectiveProjection(FOV, aspectRatio, NEAR_PLANE, FAR_PLANE);
+            device.getUploadManager().flush(); // Submits new uploads, hands finished ones over to the graphics queue
 
             if (auto commandBuffer = renderer.beginFrame()) {
+                // The fence of the frame was waited on, whatever went unused since is safe to evict
+                residencyManager.update();
+
                 uint32_t frameIndex = renderer.getCurrentFrameIndex();
                 FrameInfo frameInfo{frameIndex,
                                     deltaTime,
                                     commandBuffer,
                                     camera,
                                     globalDescriptorSets[frameIndex],
-                                    entities};
-
-                // Update cycle
-                GlobalUbo ubo{};
-                ubo.projectionMatrix = frameInfo.camera.getProjectionMatrix();
-                ubo.viewMatrix = frameInfo.camera.getViewMatrix();
-                ubo.inverseViewMatrix = camera.getInverseViewMatrix();
-                billboardRenderSystem.update(frameInfo, ubo);
-                uboBuffers[frameInfo.frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameInfo.frameIndex]->flush();
-
-                // Render cycle
-                renderer.beginSwapChainRenderPass(frameInfo.commandBuffer);
-                simpleRenderSystem.renderGameObjects(frameInfo);
-                billboardRenderSystem.render(frameInfo);
-                renderer.endSwapChainRenderPass(frameInfo.commandBuffer);
+                                    registry,
+                                    entityCommands,
+                                    timestep.getAlpha()};
+
+                scheduler.run(frameInfo);
+                entityCommands.playback(registry); // Sync point, no system is running anymore
                 renderer.endFrame();
             }
         } vkDeviceWaitIdle(device.device()); // Wait for all the resource to be freed before destroying them
     }
 
     void Application::loadEntities() {
-        entities.reserve(5);
+        // Textures are registered once in the bindless table, entities refer to them by index
+        const uint32_t texture = textureTable.add(std::make_shared<Texture>(device, "../res/textures/texture.jpg"));
 
         // Flat shaded sphere (left)
         std::shared_ptr<Model> sphereFlatModel = Model::createModelFromFile(device, "../res/models/sphere/sphere_flat.obj");
-        Entity sphereFlat = Entity::createEntity();
-        sphereFlat.addComponent(std::make_unique<ModelComponent>(sphereFlatModel));
-        sphereFlat.addComponent(std::make_unique<TransformComponent>(glm::vec3{2.5f, 0.0f, 5.0f},
-                                                                       glm::vec3{0.5f, 0.5f, 0.5f}));
-        entities.emplace(sphereFlat.getId(), std::move(sphereFlat));
+        Entity sphereFlat = registry.createEntity();
+        sphereFlat.addComponent<ModelComponent>(sphereFlatModel, texture);
+        sphereFlat.addComponent<TransformComponent>(glm::vec3{2.5f, 0.0f, 5.0f},
+                                                    glm::vec3{0.5f, 0.5f, 0.5f});
 
         // Smooth shaded sphere (right)
         std::shared_ptr<Model> sphereSmoothModel = Model::createModelFromFile(device, "../res/models/sphere/sphere_smooth.obj");
-        Entity sphereSmooth = Entity::createEntity();
-        sphereSmooth.addComponent(std::make_unique<ModelComponent>(sphereSmoothModel));
-        sphereSmooth.addComponent(std::make_unique<TransformComponent>(glm::vec3{-2.5f, 0.0f, 5.0f},
-                                                                       glm::vec3{0.5f, 0.5f, 0.5f}));
-        entities.emplace(sphereSmooth.getId(), std::move(sphereSmooth));
+        Entity sphereSmooth = registry.createEntity();
+        sphereSmooth.addComponent<ModelComponent>(sphereSmoothModel, texture);
+        sphereSmooth.addComponent<TransformComponent>(glm::vec3{-2.5f, 0.0f, 5.0f},
+                                                      glm::vec3{0.5f, 0.5f, 0.5f});
 
         // Procedural quad (center)
         Procedural::Quad q(device, 128);
         q.generateModel();
         std::shared_ptr<Model> quadModel = q.getModel();
-        Entity quad = Entity::createEntity();
-        quad.addComponent(std::make_unique<ModelComponent>(quadModel));
-        quad.addComponent(std::make_unique<TransformComponent>(glm::vec3{-2.5f, 0.0f, 5.0f},
-                                                                glm::vec3{5.0f, 5.0f, 5.0f}));
-        entities.emplace(quad.getId(), std::move(quad));
+        Entity quad = registry.createEntity();
+        quad.addComponent<ModelComponent>(quadModel, texture);
+        quad.addComponent<TransformComponent>(glm::vec3{-2.5f, 0.0f, 5.0f},
+                                              glm::vec3{5.0f, 5.0f, 5.0f});
 
         // Procedural cube (center up)
         Procedural::Cube c(device, 128);
         c.generateModel();
         std::shared_ptr<Model> cubeModel = c.getModel();
-        Entity cube = Entity::createEntity();
-        cube.addComponent(std::make_unique<ModelComponent>(cubeModel));
-        cube.addComponent(std::make_unique<TransformComponent>(glm::vec3{-0.5f, -2.0f, 5.0f}));
-        entities.emplace(cube.getId(), std::move(cube));
+        Entity cube = registry.createEntity();
+        cube.addComponent<ModelComponent>(cubeModel, texture);
+        cube.addComponent<TransformComponent>(glm::vec3{-0.5f, -2.0f, 5.0f});
 
         // Point light
-        Entity pointLight = Entity::createPointLightEntity();
-        pointLight.color = glm::vec3(1.0f, 1.0f, 1.0f);
-        pointLight.getTransformComponent()->position = glm::vec3(0.0f, -3.0f, 3.0f);
-        entities.emplace(pointLight.getId(), std::move(pointLight));
+        Entity pointLight = registry.createPointLightEntity(1.0f, 0.1f, glm::vec3(1.0f, 1.0f, 1.0f));
+        pointLight.getTransformComponent()->setPosition(glm::vec3(0.0f, -3.0f, 3.0f));
     }
 }
\ No newline at end of file
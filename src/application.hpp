@@ -14,16 +14,27 @@
 // Misc utils
 #include "utils/window/window.hpp"
 #include "utils/device/device.hpp"
+#include "utils/upload/uploadmanager.hpp"
 #include "utils/entity/entity.hpp"
 #include "utils/renderer/renderer.hpp"
 #include "utils/input/keyboard_movement_controller/keyboardmovementcontroller.hpp"
 #include "utils/descriptors/descriptors.hpp"
 #include "utils/texture/texture.hpp"
+#include "utils/texture/texturetable.hpp"
+#include "utils/residency/residencymanager.hpp"
+#include "utils/jobs/threadpool.hpp"
+#include "utils/time/fixedtimestep.hpp"
 
 // Procedural geometry
 #include "utils/procedural/quad/quad.hpp"
 #include "utils/procedural/cube/cube.hpp"
 
+// Systems
+#include "systems/transform/transformsystem.hpp"
+#include "systems/culling/cullingsystem.hpp"
+#include "systems/lighting/lightclustersystem.hpp"
+#include "systems/scheduler/systemscheduler.hpp"
+
 // Render systems
 #include "rendersystems/simple/simplerendersystem.hpp"
 #include "rendersystems/billboard/billboardrendersystem.hpp"
@@ -39,6 +50,8 @@ namespace Engine {
         static constexpr float NEAR_PLANE = 0.1f;
         static constexpr float FAR_PLANE = 100.0f;
 
+        static constexpr float SIMULATION_RATE = 60.0f; // Fixed simulation steps per second
+
         Application();
         ~Application();
 
@@ -50,7 +63,12 @@ namespace Engine {
         Window window{WIDTH, HEIGHT, "Vulkan test window"};
         Device device{window};
         Renderer renderer{window, device};
-        Entity::Map entities;
+        TextureTable textureTable{device};
+        ResidencyManager residencyManager{device, textureTable};
+        Registry registry;
+        EntityCommandBuffers entityCommands;
+        ThreadPool threadPool{};
+        FixedTimestep timestep{SIMULATION_RATE};
 
         std::unique_ptr<DescriptorPool> globalPool{};
 
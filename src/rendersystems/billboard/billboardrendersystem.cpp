@@ -1,13 +1,14 @@
 #include "billboardrendersystem.hpp"
 
 namespace Engine {
-    struct PointLightPushConstant {
-        glm::vec4 position{};
-        glm::vec4 color{};
-        float radius = 0.0f;
+    // Matches BillboardData in billboard.vert (std430)
+    struct BillboardData {
+        glm::vec4 position{}; // w = radius
+        glm::vec4 color{}; // w = intensity
     };
 
     BillboardRenderSystem::BillboardRenderSystem(Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device(device) {
+        createDescriptorResources();
         createPipelineLayout(globalSetLayout);
         createPipeline(renderPass);
     }
@@ -15,21 +16,54 @@ namespace Engine {
         vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
     }
 
-    void BillboardRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        // This is for push constants
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(PointLightPushConstant);
+    void BillboardRenderSystem::createDescriptorResources() {
+        billboardSetLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                .build();
+        descriptorPool = DescriptorPool::Builder(device)
+                .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+                .build();
+
+        for (uint32_t frameIndex = 0; frameIndex < SwapChain::MAX_FRAMES_IN_FLIGHT; frameIndex++)
+            reserveBillboards(frameIndex, INITIAL_LIGHT_CAPACITY);
+    }
+
+    void BillboardRenderSystem::reserveBillboards(uint32_t frameIndex, uint32_t count) {
+        FrameResources &frame = frames[frameIndex];
+        if (frame.billboards && frame.billboards->getInstanceCount() >= count) return;
 
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+        // The frame using this buffer last has already been waited on by Renderer::beginFrame, so it can go
+        uint32_t capacity = frame.billboards ? frame.billboards->getInstanceCount() : INITIAL_LIGHT_CAPACITY;
+        while (capacity < count) capacity *= 2;
+
+        frame.billboards = std::make_unique<Buffer>(device,
+                                                    sizeof(BillboardData),
+                                                    capacity,
+                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                    1,
+                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.billboards->map();
+
+        VkDescriptorBufferInfo bufferInfo = frame.billboards->descriptorInfo();
+        DescriptorWriter writer{*billboardSetLayout, *descriptorPool};
+        writer.writeBuffer(0, &bufferInfo);
+        if (frame.billboardSet == VK_NULL_HANDLE) {
+            if (!writer.build(frame.billboardSet))
+                throw std::runtime_error("Failed to allocate billboard descriptor set!");
+        } else writer.overwrite(frame.billboardSet);
+    }
+
+    void BillboardRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout, billboardSetLayout->getDescriptorSetLayout()};
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
         if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
             throw std::runtime_error("Failed to create pipeline layout!");
     }
@@ -47,44 +81,35 @@ namespace Engine {
                                               "../res/shaders/compiled/billboard.frag.spv",
                                               pipelineConfig);
     }
-    void BillboardRenderSystem::update(FrameInfo &frameInfo, GlobalUbo &ubo) {
-        int index = 0;
-        for (auto &kv : frameInfo.entities) {
-            auto &ent = kv.second;
-            if(!ent.hasComponent(ComponentType::POINT_LIGHT)) continue;
+    void BillboardRenderSystem::update(FrameInfo &frameInfo) {
+        auto lights = frameInfo.registry.view<TransformComponent, PointLightComponent>();
+
+        FrameResources &frame = frames[frameInfo.frameIndex];
+        reserveBillboards(frameInfo.frameIndex, static_cast<uint32_t>(lights.size()));
+        auto *billboards = static_cast<BillboardData*>(frame.billboards->getMappedMemory());
 
-            ubo.pointLights[index].position = glm::vec4(ent.getTransformComponent()->position, 1.0f);
-            ubo.pointLights[index].color = glm::vec4(ent.color, ent.getPointLightComponent()->intensity);
-            index++;
-        } ubo.pointLightCount = index;
+        uint32_t index = 0;
+        lights.each([&](TransformComponent &transform, PointLightComponent &pointLight) {
+            const glm::vec3 position{transform.mat4()[3]}; // Interpolated world position
+            billboards[index++] = {glm::vec4{position, transform.getScale().x},
+                                   glm::vec4{pointLight.color, pointLight.intensity}};
+        }); frame.billboardCount = index;
     }
     void BillboardRenderSystem::render(FrameInfo &frameInfo) {
+        const FrameResources &frame = frames[frameInfo.frameIndex];
+        if (frame.billboardCount == 0) return;
+
         pipeline->bind(frameInfo.commandBuffer);
 
+        std::array<VkDescriptorSet, 2> descriptorSets{frameInfo.globalDescriptorSet, frame.billboardSet};
         vkCmdBindDescriptorSets(frameInfo.commandBuffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 pipelineLayout,
                                 0,
-                                1,
-                                &frameInfo.globalDescriptorSet,
+                                static_cast<uint32_t>(descriptorSets.size()),
+                                descriptorSets.data(),
                                 0,
                                 nullptr);
-        for (auto &kv : frameInfo.entities) {
-            auto &ent = kv.second;
-            if(!ent.hasComponent(ComponentType::POINT_LIGHT)) continue;
-
-            PointLightPushConstant push{};
-            push.position = glm::vec4(ent.getTransformComponent()->position, 1.0f);
-            push.color = glm::vec4(ent.color, ent.getPointLightComponent()->intensity);
-            push.radius = ent.getTransformComponent()->scale.x;
-
-            vkCmdPushConstants(frameInfo.commandBuffer,
-                               pipelineLayout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0,
-                               sizeof(PointLightPushConstant),
-                               &push);
-            vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-        }
+        vkCmdDraw(frameInfo.commandBuffer, 6, frame.billboardCount, 0, 0); // One quad per light
     }
-}
\ No newline at end of file
+}
@@ -15,8 +15,14 @@
 #include "../../utils/entity/entity.hpp"
 #include "../../utils/camera/camera.hpp"
 #include "../../utils/frameinfo/frameinfo.hpp"
+#include "../../utils/buffer/buffer.hpp"
+#include "../../utils/descriptors/descriptors.hpp"
+#include "../../utils/swapchain/swapchain.hpp"
 
 namespace Engine {
+    // Draws every point light as a camera facing disc. The lights are gathered once per frame into a per-frame storage
+    // buffer by update, and render draws all of them with a single instanced call, billboard.vert picking its light
+    // with gl_InstanceIndex.
     class BillboardRenderSystem {
     public:
         BillboardRenderSystem(Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
@@ -25,15 +31,32 @@ namespace Engine {
         BillboardRenderSystem(const BillboardRenderSystem&) = delete;
         BillboardRenderSystem& operator=(const BillboardRenderSystem&) = delete;
 
-        void update(FrameInfo &frameInfo, GlobalUbo &ubo);
+        // Gathers the billboards of the frame, render draws what the last update gathered
+        void update(FrameInfo &frameInfo);
         void render(FrameInfo &frameInfo);
     private:
+        static constexpr uint32_t INITIAL_LIGHT_CAPACITY = 256;
+
+        struct FrameResources {
+            std::unique_ptr<Buffer> billboards;
+            VkDescriptorSet billboardSet = VK_NULL_HANDLE;
+            uint32_t billboardCount = 0;
+        };
+
         Device &device;
         std::unique_ptr<Pipeline> pipeline;
         VkPipelineLayout pipelineLayout;
 
+        std::unique_ptr<DescriptorSetLayout> billboardSetLayout;
+        std::unique_ptr<DescriptorPool> descriptorPool;
+        std::array<FrameResources, SwapChain::MAX_FRAMES_IN_FLIGHT> frames{};
+
+        void createDescriptorResources();
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
         void createPipeline(VkRenderPass renderPass);
+
+        // Grows the billboard buffer of a frame to fit `count` lights, it never shrinks
+        void reserveBillboards(uint32_t frameIndex, uint32_t count);
     };
 }
 
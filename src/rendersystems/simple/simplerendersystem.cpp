@@ -1,36 +1,201 @@
 #include "simplerendersystem.hpp"
 
+#include <atomic>
+#include <cstring>
+#include <numeric>
+
 namespace Engine {
-    struct SimplePushConstantData {
+    // Matches InstanceData in standard.vert and cull.comp (std430)
+    struct InstanceData {
+        static constexpr uint32_t NO_BATCH = UINT32_MAX; // Free slot of the scene buffer, cull.comp skips it
+
         glm::mat4 modelMatrix{1.0f};
         glm::mat4 normalMatrix{1.0f};
+        uint32_t batchIndex = 0; // The model id on the GPU driven path
+        uint32_t textureIndex = 0; // Into the TextureTable
+        uint32_t padding[2]{};
+    };
+
+    // Matches BatchData in cull.comp (std430)
+    struct BatchData {
+        glm::vec4 boundingSphere{0.0f}; // Model space
+        uint32_t firstInstance = 0;
+        uint32_t drawable = 0; // 0 for free model ids and models being brought back
+        uint32_t padding[2]{};
+    };
+
+    struct CullPushConstantData {
+        glm::vec4 frustumPlanes[6];
+        uint32_t objectCount;
     };
 
     SimpleRenderSystem::SimpleRenderSystem(Device &device,
                                            VkRenderPass renderPass,
-                                           VkDescriptorSetLayout globalSetLayout) : device(device) {
+                                           VkDescriptorSetLayout globalSetLayout,
+                                           const TextureTable &textureTable,
+                                           const LightClusterSystem &lightClusterSystem,
+                                           ResidencyManager &residencyManager) :
+                                           device(device),
+                                           textureTable(textureTable),
+                                           lightClusterSystem(lightClusterSystem),
+                                           residencyManager(residencyManager),
+                                           gpuDriven(device.supportsDrawIndirectCount()) {
+        createDescriptorResources();
         createPipelineLayout(globalSetLayout);
         createPipeline(renderPass);
+        if (gpuDriven) createCullPipeline();
     }
     SimpleRenderSystem::~SimpleRenderSystem() {
         vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+        if (cullPipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(device.device(), cullPipelineLayout, nullptr);
     }
 
-    void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        // This is for push constants
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
+    void SimpleRenderSystem::createDescriptorResources() {
+        instanceSetLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                .build();
+        cullSetLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Instances
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Batches
+                .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Draws
+                .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Draw counts
+                .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Visible instances
+                .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Texture states
+                .build();
+        descriptorPool = DescriptorPool::Builder(device)
+                .setMaxSets(2 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+                .build();
+
+        if (gpuDriven) scene = std::make_unique<Buffer>(device,
+                                                        sizeof(InstanceData),
+                                                        INITIAL_INSTANCE_CAPACITY,
+                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        for (uint32_t frameIndex = 0; frameIndex < SwapChain::MAX_FRAMES_IN_FLIGHT; frameIndex++) {
+            reserveInstances(frameIndex, INITIAL_INSTANCE_CAPACITY);
+            if (gpuDriven) {
+                reserveBatches(frameIndex, INITIAL_BATCH_CAPACITY);
+                reserveTextureStates(frameIndex, INITIAL_BATCH_CAPACITY);
+            } writeDescriptorSets(frameIndex);
+        }
+    }
+
+    void SimpleRenderSystem::reserveInstances(uint32_t frameIndex, uint32_t count) {
+        FrameResources &frame = frames[frameIndex];
+        // On the GPU driven path, the CPU never writes instances, the scene buffer takes their place
+        const std::unique_ptr<Buffer> &current = gpuDriven ? frame.visibleInstances : frame.instances;
+        if (current && current->getInstanceCount() >= count) return;
+
+        // The frame using these buffers last has already been waited on by Renderer::beginFrame, so they can go
+        uint32_t capacity = current ? current->getInstanceCount() : INITIAL_INSTANCE_CAPACITY;
+        while (capacity < count) capacity *= 2;
+
+        if (gpuDriven) frame.visibleInstances = std::make_unique<Buffer>(device,
+                                                                         sizeof(InstanceData),
+                                                                         capacity,
+                                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        else {
+            frame.instances = std::make_unique<Buffer>(device,
+                                                       sizeof(InstanceData),
+                                                       capacity,
+                                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                       1,
+                                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            frame.instances->map();
+        } if (frame.instanceSet != VK_NULL_HANDLE) writeDescriptorSets(frameIndex);
+    }
+
+    void SimpleRenderSystem::reserveBatches(uint32_t frameIndex, uint32_t count) {
+        FrameResources &frame = frames[frameIndex];
+        if (frame.batches && frame.batches->getInstanceCount() >= count) return;
+
+        uint32_t capacity = frame.batches ? frame.batches->getInstanceCount() : INITIAL_BATCH_CAPACITY;
+        while (capacity < count) capacity *= 2;
+
+        frame.batchCount = 0;
+        const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        frame.batches = std::make_unique<Buffer>(device,
+                                                 sizeof(BatchData),
+                                                 capacity,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                 hostVisible);
+        frame.draws = std::make_unique<Buffer>(device,
+                                               Model::INDIRECT_COMMAND_STRIDE,
+                                               capacity,
+                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                               hostVisible);
+        frame.drawCounts = std::make_unique<Buffer>(device,
+                                                    sizeof(uint32_t),
+                                                    capacity,
+                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                    hostVisible);
+        frame.batches->map();
+        frame.draws->map();
+        frame.drawCounts->map();
+        if (frame.cullSet != VK_NULL_HANDLE) writeDescriptorSets(frameIndex);
+    }
+
+    void SimpleRenderSystem::reserveTextureStates(uint32_t frameIndex, uint32_t count) {
+        FrameResources &frame = frames[frameIndex];
+        if (frame.textureStates && frame.textureStates->getInstanceCount() >= count) return;
 
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+        uint32_t capacity = frame.textureStates ? frame.textureStates->getInstanceCount() : INITIAL_BATCH_CAPACITY;
+        while (capacity < count) capacity *= 2;
+
+        frame.textureStates = std::make_unique<Buffer>(device,
+                                                       sizeof(uint32_t),
+                                                       capacity,
+                                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frame.textureStates->map();
+        if (frame.cullSet != VK_NULL_HANDLE) writeDescriptorSets(frameIndex);
+    }
+
+    void SimpleRenderSystem::writeDescriptorSets(uint32_t frameIndex) {
+        FrameResources &frame = frames[frameIndex];
+
+        // The vertex shader reads what survived culling on the GPU driven path, everything otherwise
+        VkDescriptorBufferInfo instanceInfo = gpuDriven ? frame.visibleInstances->descriptorInfo()
+                                                        : frame.instances->descriptorInfo();
+        DescriptorWriter instanceWriter{*instanceSetLayout, *descriptorPool};
+        instanceWriter.writeBuffer(0, &instanceInfo);
+        if (frame.instanceSet == VK_NULL_HANDLE) {
+            if (!instanceWriter.build(frame.instanceSet))
+                throw std::runtime_error("Failed to allocate instance descriptor set!");
+        } else instanceWriter.overwrite(frame.instanceSet);
+
+        if (!gpuDriven) return;
+
+        std::array<VkDescriptorBufferInfo, 6> cullInfos{scene->descriptorInfo(),
+                                                        frame.batches->descriptorInfo(),
+                                                        frame.draws->descriptorInfo(),
+                                                        frame.drawCounts->descriptorInfo(),
+                                                        frame.visibleInstances->descriptorInfo(),
+                                                        frame.textureStates->descriptorInfo()};
+        frame.boundScene = scene->getBuffer();
+        DescriptorWriter cullWriter{*cullSetLayout, *descriptorPool};
+        for (uint32_t binding = 0; binding < cullInfos.size(); binding++) cullWriter.writeBuffer(binding, &cullInfos[binding]);
+        if (frame.cullSet == VK_NULL_HANDLE) {
+            if (!cullWriter.build(frame.cullSet))
+                throw std::runtime_error("Failed to allocate culling descriptor set!");
+        } else cullWriter.overwrite(frame.cullSet);
+    }
+
+    void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout,
+                                                                instanceSetLayout->getDescriptorSetLayout(),
+                                                                textureTable.getSetLayout(),
+                                                                lightClusterSystem.getSetLayout()};
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
         if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
             throw std::runtime_error("Failed to create pipeline layout!");
     }
@@ -46,35 +211,442 @@ namespace Engine {
                                               "../res/shaders/compiled/standard.frag.spv",
                                               pipelineConfig);
     }
-    void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
-        pipeline->bind(frameInfo.commandBuffer);
+    void SimpleRenderSystem::createCullPipeline() {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(CullPushConstantData);
+
+        VkDescriptorSetLayout setLayout = cullSetLayout->getDescriptorSetLayout();
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create culling pipeline layout!");
+
+        cullPipeline = std::make_unique<ComputePipeline>(device, "../res/shaders/compiled/cull.comp.spv", cullPipelineLayout);
+    }
+
+    void SimpleRenderSystem::prepare(FrameInfo &frameInfo) {
+        stats = {};
+        if (!gpuDriven) {
+            prepareQueue(frameInfo);
+            return;
+        }
+
+        FrameResources &frame = frames[frameInfo.frameIndex];
+        stats.visibleCount = readVisibleCount(frame);
+        frame.retiredScene.reset(); // Every frame that could still read it has been waited on
+
+        updateScene(frameInfo);
+        recordSceneUpdates(frameInfo);
+        stats.drawCount = static_cast<uint32_t>(batches.size());
+        if (batches.empty()) frame.batchCount = 0;
+        else recordCulling(frameInfo);
+    }
+
+    void SimpleRenderSystem::prepareQueue(FrameInfo &frameInfo) {
+        // Queue every entity, keyed by its model and its distance to the camera
+        // Entities culled by the CullingSystem are skipped
+        // So are entities whose model or texture was evicted, until the ResidencyManager brought them back
+        const glm::mat4 &viewMatrix = frameInfo.camera.getViewMatrix();
+        queue.clear();
+        queuedEntities.clear();
+        meshIds.clear();
+        frameInfo.registry.view<TransformComponent, ModelComponent>().each([&](TransformComponent &transform,
+                                                                               ModelComponent &model) {
+            if (!model.visible) return;
+            auto [it, inserted] = meshIds.try_emplace(model.model.get(), static_cast<uint32_t>(meshIds.size()));
+            if (inserted && !residencyManager.requestModel(model.model)) it->second = NOT_RESIDENT;
+            if (it->second == NOT_RESIDENT || !residencyManager.requestTexture(model.textureIndex)) {
+                stats.nonResidentCount++;
+                return;
+            }
+            assert(it->second < RenderQueue::MAX_MESHES && "Too many different models in a frame for the draw keys!");
+
+            const float depth = (viewMatrix * transform.mat4()[3]).z;
+            queue.submit(RenderQueue::makeKey(PASS, PIPELINE, MATERIAL, it->second, depth),
+                         static_cast<uint32_t>(queuedEntities.size()));
+            queuedEntities.push_back({&transform, &model});
+        });
+        queue.sort();
+
+        instanceCount = static_cast<uint32_t>(queue.size());
+        stats.instanceCount = instanceCount;
+        stats.visibleCount = instanceCount;
+        batches.clear();
+        if (queue.empty()) return;
+
+        // Instances go in sorted order, a new batch starts whenever the state changes
+        reserveInstances(frameInfo.frameIndex, instanceCount);
+        auto *instances = static_cast<InstanceData*>(frames[frameInfo.frameIndex].instances->getMappedMemory());
+        const auto packets = queue.getPackets();
+        for (uint32_t i = 0; i < packets.size(); i++) {
+            const QueuedEntity &entity = queuedEntities[packets[i].index];
+            if (batches.empty() || !RenderQueue::sameState(batches.back().key, packets[i].key))
+                batches.push_back({entity.model->model.get(), packets[i].key, i, 0, 0});
+            batches.back().instanceCount++;
+
+            InstanceData &instance = instances[i];
+            instance.modelMatrix = entity.transform->mat4();
+            instance.normalMatrix = entity.transform->normal();
+            instance.batchIndex = static_cast<uint32_t>(batches.size() - 1);
+            instance.textureIndex = entity.model->textureIndex;
+        }
+
+        stats.drawCount = static_cast<uint32_t>(batches.size());
+    }
+
+    void SimpleRenderSystem::updateScene(FrameInfo &frameInfo) {
+        sceneWalk++;
+        dirtySlots.clear();
+
+        // Entities keep their slot, a slot is only copied again when its transform was rebuilt (see
+        // TransformComponent::getVersion) or the entity switched model or texture.
+        // Visibility flags are ignored, the CullingSystem doesn't run on this path and cull.comp decides
+        frameInfo.registry.view<TransformComponent, ModelComponent>().eachWithId([&](Entity::id_t id,
+                                                                                     TransformComponent &transform,
+                                                                                     ModelComponent &model) {
+            const uint32_t index = Entity::indexOf(id);
+            if (index >= entitySlots.size()) entitySlots.resize(index + 1, NO_SLOT);
 
+            bool dirty = false;
+            if (entitySlots[index] == NO_SLOT || sceneObjects[entitySlots[index]].entity != id) {
+                entitySlots[index] = addSceneObject(id, model);
+                dirty = true;
+            }
+            const uint32_t slot = entitySlots[index];
+            SceneObject &object = sceneObjects[slot];
+            object.lastSeen = sceneWalk;
+            sceneTransforms[slot] = &transform;
+
+            if (sceneModels[object.modelId].model != model.model) {
+                releaseModelId(object.modelId);
+                object.modelId = acquireModelId(model.model);
+                dirty = true;
+            }
+            if (object.textureIndex != model.textureIndex) {
+                if (textureObjectCounts.size() <= model.textureIndex) textureObjectCounts.resize(model.textureIndex + 1, 0);
+                textureObjectCounts[object.textureIndex]--;
+                textureObjectCounts[model.textureIndex]++;
+                object.textureIndex = model.textureIndex;
+                dirty = true;
+            }
+            if (dirty || object.transformVersion != transform.getVersion()) {
+                object.transformVersion = transform.getVersion();
+                dirtySlots.push_back(slot);
+            }
+        });
+
+        // Entities only ever leave the view through a structural change, the walk didn't find them anymore
+        if (frameInfo.registry.getStructureVersion() != sceneStructureVersion) {
+            sceneStructureVersion = frameInfo.registry.getStructureVersion();
+            for (uint32_t slot = 0; slot < sceneObjects.size(); slot++) {
+                if (sceneObjects[slot].entity == Entity::NULL_ID || sceneObjects[slot].lastSeen == sceneWalk) continue;
+                removeSceneObject(slot);
+                dirtySlots.push_back(slot);
+            }
+        }
+
+        // One draw per model whose mesh is resident, with an instance range as large as its object count. Residency
+        // is requested once per model and texture in use, not per entity
+        batches.clear();
+        instanceCount = 0;
+        for (uint32_t modelId = 0; modelId < sceneModels.size(); modelId++) {
+            const SceneModel &sceneModel = sceneModels[modelId];
+            if (!sceneModel.model) continue;
+            if (!residencyManager.requestModel(sceneModel.model)) {
+                stats.nonResidentCount += sceneModel.objectCount;
+                continue;
+            }
+            assert(modelId < RenderQueue::MAX_MESHES && "Too many different models in the scene for the draw keys!");
+
+            batches.push_back({sceneModel.model.get(),
+                               RenderQueue::makeKey(PASS, PIPELINE, MATERIAL, modelId, 0.0f),
+                               instanceCount,
+                               sceneModel.objectCount,
+                               modelId});
+            instanceCount += sceneModel.objectCount;
+        }
+        stats.instanceCount = instanceCount;
+
+        // Objects with a texture that can't be sampled yet are dropped by cull.comp
+        if (textureObjectCounts.size() < textureTable.size()) textureObjectCounts.resize(textureTable.size(), 0);
+        reserveTextureStates(frameInfo.frameIndex, static_cast<uint32_t>(textureObjectCounts.size()));
+        auto *textureStates = static_cast<uint32_t*>(frames[frameInfo.frameIndex].textureStates->getMappedMemory());
+        for (uint32_t i = 0; i < textureObjectCounts.size(); i++) {
+            textureStates[i] = textureObjectCounts[i] > 0 && residencyManager.requestTexture(i);
+            if (!textureStates[i]) stats.nonResidentCount += textureObjectCounts[i];
+        }
+    }
+
+    uint32_t SimpleRenderSystem::addSceneObject(Entity::id_t entity, const ModelComponent &model) {
+        uint32_t slot;
+        if (freeSlots.empty()) {
+            slot = static_cast<uint32_t>(sceneObjects.size());
+            sceneObjects.emplace_back();
+            sceneTransforms.push_back(nullptr);
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        if (textureObjectCounts.size() <= model.textureIndex) textureObjectCounts.resize(model.textureIndex + 1, 0);
+        textureObjectCounts[model.textureIndex]++;
+        sceneObjects[slot] = {entity, acquireModelId(model.model), model.textureIndex, 0, sceneWalk};
+        return slot;
+    }
+
+    void SimpleRenderSystem::removeSceneObject(uint32_t slot) {
+        SceneObject &object = sceneObjects[slot];
+        const uint32_t index = Entity::indexOf(object.entity);
+        if (entitySlots[index] == slot) entitySlots[index] = NO_SLOT; // Unless a new entity took over the index
+
+        releaseModelId(object.modelId);
+        textureObjectCounts[object.textureIndex]--;
+        object.entity = Entity::NULL_ID;
+        freeSlots.push_back(slot);
+    }
+
+    uint32_t SimpleRenderSystem::acquireModelId(const std::shared_ptr<Model> &model) {
+        auto [it, inserted] = sceneModelIds.try_emplace(model.get(), 0);
+        if (inserted) {
+            if (freeModelIds.empty()) {
+                it->second = static_cast<uint32_t>(sceneModels.size());
+                sceneModels.emplace_back();
+            } else {
+                it->second = freeModelIds.back();
+                freeModelIds.pop_back();
+            } sceneModels[it->second].model = model;
+        }
+        sceneModels[it->second].objectCount++;
+        return it->second;
+    }
+
+    void SimpleRenderSystem::releaseModelId(uint32_t modelId) {
+        SceneModel &sceneModel = sceneModels[modelId];
+        if (--sceneModel.objectCount > 0) return;
+
+        sceneModelIds.erase(sceneModel.model.get());
+        sceneModel.model.reset();
+        freeModelIds.push_back(modelId);
+    }
+
+    void SimpleRenderSystem::recordSceneUpdates(FrameInfo &frameInfo) {
+        FrameResources &frame = frames[frameInfo.frameIndex];
+        const auto slotCount = static_cast<uint32_t>(sceneObjects.size());
+
+        // A new scene buffer starts out empty, so everything is copied in again. Frames in flight still read the old one
+        if (scene->getInstanceCount() < slotCount) {
+            uint32_t capacity = scene->getInstanceCount();
+            while (capacity < slotCount) capacity *= 2;
+
+            frame.retiredScene = std::move(scene);
+            scene = std::make_unique<Buffer>(device,
+                                             sizeof(InstanceData),
+                                             capacity,
+                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            dirtySlots.resize(slotCount);
+            std::iota(dirtySlots.begin(), dirtySlots.end(), 0);
+        }
+        if (frame.boundScene != scene->getBuffer()) writeDescriptorSets(frameInfo.frameIndex);
+        if (dirtySlots.empty()) return;
+
+        const auto updateCount = static_cast<uint32_t>(dirtySlots.size());
+        if (!frame.sceneUpdates || frame.sceneUpdates->getInstanceCount() < updateCount) {
+            uint32_t capacity = frame.sceneUpdates ? frame.sceneUpdates->getInstanceCount() : INITIAL_INSTANCE_CAPACITY;
+            while (capacity < updateCount) capacity *= 2;
+
+            frame.sceneUpdates = std::make_unique<Buffer>(device,
+                                                          sizeof(InstanceData),
+                                                          capacity,
+                                                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            frame.sceneUpdates->map();
+        }
+
+        // Slots are staged in the order they were found, runs of consecutive slots become a single copy region
+        std::vector<VkBufferCopy> regions;
+        auto *updates = static_cast<InstanceData*>(frame.sceneUpdates->getMappedMemory());
+        for (uint32_t i = 0; i < updateCount; i++) {
+            const uint32_t slot = dirtySlots[i];
+            const SceneObject &object = sceneObjects[slot];
+            InstanceData &instance = updates[i];
+            if (object.entity == Entity::NULL_ID) {
+                instance = {};
+                instance.batchIndex = InstanceData::NO_BATCH;
+            } else {
+                const TransformComponent &transform = *sceneTransforms[slot];
+                instance.modelMatrix = transform.mat4();
+                instance.normalMatrix = transform.normal();
+                instance.batchIndex = object.modelId;
+                instance.textureIndex = object.textureIndex;
+            }
+
+            const VkDeviceSize srcOffset = i * sizeof(InstanceData);
+            const VkDeviceSize dstOffset = slot * sizeof(InstanceData);
+            if (!regions.empty() && regions.back().srcOffset + regions.back().size == srcOffset &&
+                regions.back().dstOffset + regions.back().size == dstOffset) regions.back().size += sizeof(InstanceData);
+            else regions.push_back({srcOffset, dstOffset, sizeof(InstanceData)});
+        }
+
+        // Earlier frames may still be culling from the slots, or copying into them
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(frameInfo.commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+        vkCmdCopyBuffer(frameInfo.commandBuffer,
+                        frame.sceneUpdates->getBuffer(),
+                        scene->getBuffer(),
+                        static_cast<uint32_t>(regions.size()),
+                        regions.data());
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(frameInfo.commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+    }
+
+    void SimpleRenderSystem::recordCulling(FrameInfo &frameInfo) {
+        const auto modelCount = static_cast<uint32_t>(sceneModels.size());
+        reserveBatches(frameInfo.frameIndex, modelCount);
+        reserveInstances(frameInfo.frameIndex, instanceCount);
+
+        // Every draw starts empty, the compute shader adds the instances that pass. Free model ids and models being
+        // brought back keep an empty draw that is never recorded
+        FrameResources &frame = frames[frameInfo.frameIndex];
+        auto *batchData = static_cast<BatchData*>(frame.batches->getMappedMemory());
+        auto *draws = static_cast<std::byte*>(frame.draws->getMappedMemory());
+        auto *drawCounts = static_cast<uint32_t*>(frame.drawCounts->getMappedMemory());
+        std::fill_n(batchData, modelCount, BatchData{});
+        std::memset(draws, 0, modelCount * Model::INDIRECT_COMMAND_STRIDE);
+        std::fill_n(drawCounts, modelCount, 0u);
+        for (const Batch &batch : batches) {
+            BatchData &data = batchData[batch.drawIndex];
+            data.boundingSphere = batch.model->getBoundingSphere();
+            data.firstInstance = batch.firstInstance;
+            data.drawable = 1;
+            batch.model->writeIndirectCommand(draws + batch.drawIndex * Model::INDIRECT_COMMAND_STRIDE, 0, batch.firstInstance);
+        }
+        frame.batchCount = modelCount;
+
+        CullPushConstantData push{};
+        const auto planes = frameInfo.camera.getFrustumPlanes();
+        std::copy(planes.begin(), planes.end(), push.frustumPlanes);
+        push.objectCount = static_cast<uint32_t>(sceneObjects.size());
+
+        cullPipeline->bind(frameInfo.commandBuffer);
         vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                pipelineLayout,
+                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                cullPipelineLayout,
                                 0,
                                 1,
-                                &frameInfo.globalDescriptorSet,
+                                &frame.cullSet,
                                 0,
                                 nullptr);
+        vkCmdPushConstants(frameInfo.commandBuffer,
+                           cullPipelineLayout,
+                           VK_SHADER_STAGE_COMPUTE_BIT,
+                           0,
+                           sizeof(CullPushConstantData),
+                           &push);
+        vkCmdDispatch(frameInfo.commandBuffer, (push.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
 
-        for (auto &kv : frameInfo.entities) {
-            auto &ent = kv.second; // Extract the second element of the pair (the GameObject)
-            if (!ent.hasComponent(ComponentType::MODEL)) continue;
+        // The draws, their counts and the compacted instances have to land before the render pass reads them, and the
+        // instance counts of the draws before readVisibleCount does, once the frame's fence signaled
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(frameInfo.commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                             0,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+    }
 
-            SimplePushConstantData push{};
-            push.modelMatrix = ent.getTransformComponent()->mat4();
-            push.normalMatrix = ent.getTransformComponent()->normal();
+    uint32_t SimpleRenderSystem::readVisibleCount(FrameResources &frame) {
+        if (!frame.draws || frame.batchCount == 0) return 0;
+        // A no-op as long as the draws buffer is host coherent
+        if (frame.draws->invalidate() != VK_SUCCESS) throw std::runtime_error("Failed to invalidate the draws buffer!");
 
-            vkCmdPushConstants(frameInfo.commandBuffer,
-                               pipelineLayout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0,
-                               sizeof(SimplePushConstantData),
-                               &push);
+        // instanceCount is the second word of both kinds of indirect command
+        uint32_t visible = 0;
+        const auto *draws = static_cast<const std::byte*>(frame.draws->getMappedMemory());
+        for (uint32_t i = 0; i < frame.batchCount; i++) {
+            uint32_t drawInstances;
+            std::memcpy(&drawInstances, draws + i * Model::INDIRECT_COMMAND_STRIDE + sizeof(uint32_t), sizeof(uint32_t));
+            visible += drawInstances;
+        } return visible;
+    }
 
-            ent.getModelComponent()->model->bind(frameInfo.commandBuffer);
-            ent.getModelComponent()->model->draw(frameInfo.commandBuffer);
-        }
+    void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
+        renderGameObjects(frameInfo, 0, batches.size());
+    }
+
+    void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo, size_t firstBatch, size_t lastBatch) {
+        if (firstBatch >= lastBatch) return;
+        FrameResources &frame = frames[frameInfo.frameIndex];
+
+        pipeline->bind(frameInfo.commandBuffer);
+
+        // The texture table never changes between draws, every instance picks its texture by index
+        std::array<VkDescriptorSet, 4> descriptorSets{frameInfo.globalDescriptorSet,
+                                                      frame.instanceSet,
+                                                      textureTable.getDescriptorSet(),
+                                                      lightClusterSystem.getDescriptorSet(frameInfo.frameIndex)};
+        vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelineLayout,
+                                0,
+                                static_cast<uint32_t>(descriptorSets.size()),
+                                descriptorSets.data(),
+                                0,
+                                nullptr);
+
+        uint32_t meshBinds = 0;
+        for (auto i = static_cast<uint32_t>(firstBatch); i < lastBatch; i++) {
+            const Batch &batch = batches[i];
+            // Batches only split on state changes, but the mesh may well stay the same across them
+            if (i == firstBatch || RenderQueue::getMesh(batch.key) != RenderQueue::getMesh(batches[i - 1].key)) {
+                batch.model->bind(frameInfo.commandBuffer);
+                meshBinds++;
+            }
+            if (gpuDriven) batch.model->drawIndirectCount(frameInfo.commandBuffer,
+                                                          frame.draws->getBuffer(),
+                                                          batch.drawIndex * Model::INDIRECT_COMMAND_STRIDE,
+                                                          frame.drawCounts->getBuffer(),
+                                                          batch.drawIndex * sizeof(uint32_t),
+                                                          1);
+            else batch.model->draw(frameInfo.commandBuffer, batch.instanceCount, batch.firstInstance);
+        } std::atomic_ref<uint32_t>(stats.meshBindCount).fetch_add(meshBinds, std::memory_order_relaxed); // Ranges may be recorded in parallel
     }
-}
\ No newline at end of file
+}
@@ -9,33 +9,194 @@
 #include <memory>
 #include <vector>
 #include <array>
+#include <unordered_map>
 
 #include "../../utils/device/device.hpp"
 #include "../../utils/pipeline/pipeline.hpp"
 #include "../../utils/entity/entity.hpp"
 #include "../../utils/camera/camera.hpp"
 #include "../../utils/frameinfo/frameinfo.hpp"
+#include "../../utils/buffer/buffer.hpp"
+#include "../../utils/descriptors/descriptors.hpp"
+#include "../../utils/swapchain/swapchain.hpp"
+#include "../../utils/texture/texturetable.hpp"
+#include "../../utils/renderqueue/renderqueue.hpp"
+#include "../../utils/residency/residencymanager.hpp"
+#include "../../systems/lighting/lightclustersystem.hpp"
 
 namespace Engine {
+    // Draws every entity with a model, instanced: entities are queued in a RenderQueue each frame, and the sorted queue
+    // groups them by model and front to back within each model. Their matrices are written in that order to a per-frame
+    // storage buffer, and each model is drawn once for all of its entities.
+    //
+    // When the device supports drawIndirectCount, drawing is GPU driven and nothing is queued nor sorted. Every entity
+    // keeps a slot in a persistent scene buffer, and only the slots of entities that moved, changed model or texture,
+    // came or went are copied in each frame. A compute pass (cull.comp) frustum tests every object against its model's
+    // bounding sphere and compacts the survivors into the instance range of their model, bumping the instance count of
+    // the model's indirect draw. The CPU never learns what got culled, it just issues one vkCmdDrawIndexedIndirectCount
+    // per model.
+    //
+    // Textures come from the bindless TextureTable, each instance carries its own texture index. Lights come from the
+    // clusters of the LightClusterSystem.
     class SimpleRenderSystem {
     public:
+        // Below this many draws per secondary command buffer, splitting the recording costs more than it saves
+        static constexpr size_t MIN_BATCHES_PER_SLICE = 512;
+
+        struct Stats {
+            uint32_t drawCount = 0;
+            uint32_t instanceCount = 0; // Entities submitted
+            uint32_t visibleCount = 0; // Instances drawn, on the GPU driven path as of MAX_FRAMES_IN_FLIGHT frames ago
+            uint32_t meshBindCount = 0; // Vertex and index buffer binds, redundant ones are skipped
+            // Entities skipped while their model or texture is being brought back, on the GPU driven path one missing
+            // both counts twice
+            uint32_t nonResidentCount = 0;
+        };
+
         SimpleRenderSystem(Device &device,
                            VkRenderPass renderPass,
-                           VkDescriptorSetLayout globalSetLayout);
+                           VkDescriptorSetLayout globalSetLayout,
+                           const TextureTable &textureTable,
+                           const LightClusterSystem &lightClusterSystem,
+                           ResidencyManager &residencyManager);
         ~SimpleRenderSystem();
 
         SimpleRenderSystem(const SimpleRenderSystem&) = delete;
         SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
+        // Fills the instance data of the frame, or on the GPU driven path records the scene buffer updates and the culling
+        // dispatch. It has to be called outside of the render pass, before renderGameObjects.
+        void prepare(FrameInfo &frameInfo);
         void renderGameObjects(FrameInfo &frameInfo);
+
+        // Draws batches [firstBatch, lastBatch) into frameInfo.commandBuffer. Different ranges can be recorded at the same
+        // time into different command buffers (see Renderer::recordSecondary).
+        void renderGameObjects(FrameInfo &frameInfo, size_t firstBatch, size_t lastBatch);
+
+        // Draw calls recorded by renderGameObjects, known once prepare ran
+        size_t getBatchCount() const { return batches.size(); }
+
+        bool isGpuDriven() const { return gpuDriven; }
+        const Stats &getStats() const { return stats; }
     private:
+        static constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+        static constexpr uint32_t INITIAL_BATCH_CAPACITY = 64;
+        static constexpr uint32_t CULL_GROUP_SIZE = 64; // local_size_x in cull.comp
+
+        // Draw key fields, there's a single pass and pipeline for now. Textures are bindless and picked per instance, so
+        // nothing material related is ever rebound, and keying on it would only split instanced draws.
+        static constexpr uint32_t PASS = 0;
+        static constexpr uint32_t PIPELINE = 0;
+        static constexpr uint32_t MATERIAL = 0;
+        static constexpr uint32_t NOT_RESIDENT = UINT32_MAX; // In meshIds, for models that can't be drawn this frame
+        static constexpr uint32_t NO_SLOT = UINT32_MAX; // In entitySlots
+
+        // Consecutive queued entities sharing all their state, laid out contiguously in the instance buffer
+        struct Batch {
+            Model *model;
+            uint64_t key; // Of its first (nearest) instance
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+            uint32_t drawIndex; // Into the draws of the frame on the GPU driven path, the id of the model
+        };
+
+        struct QueuedEntity {
+            const TransformComponent *transform;
+            const ModelComponent *model;
+        };
+
+        // What the CPU knows about a slot of the scene buffer
+        struct SceneObject {
+            Entity::id_t entity = Entity::NULL_ID; // NULL_ID while the slot is free
+            uint32_t modelId = 0;
+            uint32_t textureIndex = 0;
+            uint32_t transformVersion = 0; // Of the matrices last copied into the slot
+            uint64_t lastSeen = 0; // Walk of the registry that last found the entity
+        };
+
+        // Models get an id for as long as some entity uses them, it's the batch index of their scene entries
+        struct SceneModel {
+            std::shared_ptr<Model> model; // Null while the id is free
+            uint32_t objectCount = 0;
+        };
+
+        // Everything the GPU reads while drawing a frame, one set per frame in flight so the CPU only ever writes to
+        // buffers the GPU is done with (Renderer::beginFrame waits for that)
+        struct FrameResources {
+            std::unique_ptr<Buffer> instances; // Written by the CPU, grouped by model, device local when it can be mapped
+            std::unique_ptr<Buffer> visibleInstances; // The instances surviving culling, compacted by the GPU
+            std::unique_ptr<Buffer> batches; // Bounding sphere and instance range of every model id
+            std::unique_ptr<Buffer> draws; // One indirect command per model id
+            std::unique_ptr<Buffer> drawCounts; // Per model id, 1 if anything of it survived culling, 0 otherwise
+            std::unique_ptr<Buffer> textureStates; // Per texture, 1 if it can be sampled
+            std::unique_ptr<Buffer> sceneUpdates; // Staging for the scene slots copied this frame
+            std::unique_ptr<Buffer> retiredScene; // Outgrown scene buffer, until the frames before this one are done
+            VkBuffer boundScene = VK_NULL_HANDLE; // Scene buffer cullSet points to
+            VkDescriptorSet instanceSet = VK_NULL_HANDLE;
+            VkDescriptorSet cullSet = VK_NULL_HANDLE;
+            uint32_t batchCount = 0; // Model ids in the draws buffer, to read back the stats
+        };
+
         Device &device;
+        const TextureTable &textureTable;
+        const LightClusterSystem &lightClusterSystem;
+        ResidencyManager &residencyManager;
+        bool gpuDriven;
+
         std::unique_ptr<Pipeline> pipeline;
         VkPipelineLayout pipelineLayout;
 
+        std::unique_ptr<ComputePipeline> cullPipeline;
+        VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+
+        std::unique_ptr<DescriptorSetLayout> instanceSetLayout;
+        std::unique_ptr<DescriptorSetLayout> cullSetLayout;
+        std::unique_ptr<DescriptorPool> descriptorPool;
+        std::array<FrameResources, SwapChain::MAX_FRAMES_IN_FLIGHT> frames{};
+
+        RenderQueue queue;
+        std::vector<QueuedEntity> queuedEntities; // Indexed by the packets of the queue
+        std::unordered_map<Model*, uint32_t> meshIds; // Mesh field of the draw keys, assigned anew every frame
+        std::vector<Batch> batches;
+        uint32_t instanceCount = 0;
+        Stats stats{};
+
+        // GPU driven path. The scene buffer is device local, and only ever written by copies recorded in the frame's
+        // command buffer, so it's shared by every frame in flight
+        std::unique_ptr<Buffer> scene;
+        std::vector<SceneObject> sceneObjects; // Indexed by slot
+        std::vector<const TransformComponent*> sceneTransforms; // Indexed by slot, valid for the slots seen this walk
+        std::vector<uint32_t> freeSlots;
+        std::vector<uint32_t> entitySlots; // Indexed by Entity::indexOf
+        std::vector<uint32_t> dirtySlots; // To copy into the scene buffer this frame
+        std::vector<SceneModel> sceneModels; // Indexed by model id
+        std::unordered_map<const Model*, uint32_t> sceneModelIds;
+        std::vector<uint32_t> freeModelIds;
+        std::vector<uint32_t> textureObjectCounts; // Indexed like the texture table
+        uint64_t sceneWalk = 0;
+        uint64_t sceneStructureVersion = UINT64_MAX; // Registry::getStructureVersion as of the last walk
+
+        void createDescriptorResources();
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
         void createPipeline(VkRenderPass renderPass);
+        void createCullPipeline();
+
+        // Make sure the buffers of a frame fit `count` instances, models or textures, they are only ever grown
+        void reserveInstances(uint32_t frameIndex, uint32_t count);
+        void reserveBatches(uint32_t frameIndex, uint32_t count);
+        void reserveTextureStates(uint32_t frameIndex, uint32_t count);
+        void writeDescriptorSets(uint32_t frameIndex);
+
+        void prepareQueue(FrameInfo &frameInfo);
+        void updateScene(FrameInfo &frameInfo);
+        uint32_t addSceneObject(Entity::id_t entity, const ModelComponent &model);
+        void removeSceneObject(uint32_t slot);
+        uint32_t acquireModelId(const std::shared_ptr<Model> &model);
+        void releaseModelId(uint32_t modelId);
+        void recordSceneUpdates(FrameInfo &frameInfo);
+        void recordCulling(FrameInfo &frameInfo);
+        uint32_t readVisibleCount(FrameResources &frame);
     };
 }
 
-#endif
\ No newline at end of file
+#endif
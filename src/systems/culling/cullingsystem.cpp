@@ -0,0 +1,52 @@
+#include "cullingsystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace Engine {
+    void CullingSystem::update(Registry &registry, const Camera &camera) {
+        stats = {};
+        const CullingKernel::Planes planes = camera.getFrustumPlanes();
+        std::atomic<uint32_t> visibleCount{0};
+
+        registry.view<TransformComponent, ModelComponent>().eachArchetype([&](Archetype &archetype) {
+            const TransformComponent *transforms = archetype.column<TransformComponent>();
+            ModelComponent *models = archetype.column<ModelComponent>();
+
+            threadPool.parallelFor(archetype.size(), MIN_ENTITIES_PER_TASK, [&](size_t begin, size_t end) {
+                float centerX[GATHER_BATCH], centerY[GATHER_BATCH], centerZ[GATHER_BATCH], radius[GATHER_BATCH];
+                uint8_t visible[GATHER_BATCH];
+                uint32_t localVisible = 0;
+
+                for (size_t first = begin; first < end; first += GATHER_BATCH) {
+                    const size_t count = std::min(GATHER_BATCH, end - first);
+
+                    // Model space sphere to world space, the radius grows with the largest scale so it stays conservative
+                    for (size_t i = 0; i < count; i++) {
+                        const glm::mat4 &matrix = transforms[first + i].mat4();
+                        const glm::vec4 sphere = models[first + i].model->getBoundingSphere();
+                        const glm::vec3 center{matrix * glm::vec4{glm::vec3{sphere}, 1.0f}};
+                        const float scale = std::max({glm::dot(glm::vec3{matrix[0]}, glm::vec3{matrix[0]}),
+                                                      glm::dot(glm::vec3{matrix[1]}, glm::vec3{matrix[1]}),
+                                                      glm::dot(glm::vec3{matrix[2]}, glm::vec3{matrix[2]})});
+
+                        centerX[i] = center.x;
+                        centerY[i] = center.y;
+                        centerZ[i] = center.z;
+                        radius[i] = sphere.w * glm::sqrt(scale);
+                    }
+
+                    const CullingKernel::SphereArrays spheres{centerX, centerY, centerZ, radius};
+                    localVisible += static_cast<uint32_t>(CullingKernel::testSpheres(spheres, count, planes, visible));
+
+                    for (size_t i = 0; i < count; i++) models[first + i].visible = visible[i] != 0;
+                }
+                visibleCount.fetch_add(localVisible, std::memory_order_relaxed);
+            });
+            stats.testedCount += static_cast<uint32_t>(archetype.size());
+        });
+
+        stats.visibleCount = visibleCount.load();
+        stats.culledCount = stats.testedCount - stats.visibleCount;
+    }
+}
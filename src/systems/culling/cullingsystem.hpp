@@ -0,0 +1,42 @@
+#ifndef CULLINGSYSTEM_HPP
+#define CULLINGSYSTEM_HPP
+
+#include <cstdint>
+
+#include "../../utils/entity/entity.hpp"
+#include "../../utils/camera/camera.hpp"
+#include "../../utils/jobs/threadpool.hpp"
+#include "../../utils/math/cullingkernel.hpp"
+
+namespace Engine {
+    // Frustum culls every entity with a model on the CPU, flagging the ones that can be skipped (ModelComponent::visible).
+    // The bounding sphere of each model is moved to world space and gathered into small structure of arrays batches,
+    // which the SIMD culling kernel tests against the six camera planes several spheres at a time. Archetypes are split
+    // across the thread pool.
+    // Has to run after the TransformSystem, it reads the cached world matrices.
+    class CullingSystem {
+    public:
+        struct Stats {
+            uint32_t testedCount = 0;
+            uint32_t visibleCount = 0;
+            uint32_t culledCount = 0;
+        };
+
+        explicit CullingSystem(ThreadPool &threadPool) : threadPool(threadPool) {}
+
+        CullingSystem(const CullingSystem &) = delete;
+        CullingSystem &operator=(const CullingSystem &) = delete;
+
+        void update(Registry &registry, const Camera &camera);
+
+        const Stats &getStats() const { return stats; }
+    private:
+        static constexpr size_t MIN_ENTITIES_PER_TASK = 4096;
+        static constexpr size_t GATHER_BATCH = 256; // Spheres gathered on the stack before each kernel call
+
+        ThreadPool &threadPool;
+        Stats stats{};
+    };
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include "lightclustersystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Engine {
+    // Matches LightData in standard.frag (std430)
+    struct LightData {
+        glm::vec4 position{}; // w = radius
+        glm::vec4 color{}; // w = intensity
+    };
+
+    // Matches ClusterData in standard.frag (std430)
+    struct ClusterData {
+        uint32_t offset; // First light index of the cluster
+        uint32_t count;
+    };
+
+    // Screen tiles [first, last] covered by the box [min, max] x [near, far] in view space, along one axis, where
+    // scale is the matching diagonal entry of the projection. Empty when first > last.
+    static std::pair<int, int> tileRange(float min, float max, float near, float far, float scale, uint32_t tiles) {
+        // Largest and smallest slope from the eye to the box, on a perspective projection NDC is slope * scale
+        const float low = min / (min < 0.0f ? near : far);
+        const float high = max / (max > 0.0f ? near : far);
+        const float a = low * scale;
+        const float b = high * scale;
+
+        const float ndcMin = std::min(a, b);
+        const float ndcMax = std::max(a, b);
+        if (ndcMax < -1.0f || ndcMin > 1.0f) return {1, 0};
+
+        const auto last = static_cast<float>(tiles - 1);
+        return {static_cast<int>(std::clamp(std::floor((ndcMin + 1.0f) * 0.5f * static_cast<float>(tiles)), 0.0f, last)),
+                static_cast<int>(std::clamp(std::floor((ndcMax + 1.0f) * 0.5f * static_cast<float>(tiles)), 0.0f, last))};
+    }
+
+    LightClusterSystem::LightClusterSystem(Device &device, ThreadPool &threadPool) :
+        device(device), threadPool(threadPool), clusterLights(CLUSTER_COUNT) {
+        createDescriptorResources();
+    }
+
+    void LightClusterSystem::createDescriptorResources() {
+        setLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT) // Lights
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT) // Clusters
+                .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT) // Light indices
+                .build();
+        descriptorPool = DescriptorPool::Builder(device)
+                .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+                .build();
+
+        for (uint32_t frameIndex = 0; frameIndex < SwapChain::MAX_FRAMES_IN_FLIGHT; frameIndex++) {
+            FrameResources &frame = frames[frameIndex];
+            frame.clusters = std::make_unique<Buffer>(device,
+                                                      sizeof(ClusterData),
+                                                      CLUSTER_COUNT,
+                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                      1,
+                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            frame.clusters->map();
+
+            // Nothing is assigned until the first update
+            std::fill_n(static_cast<ClusterData*>(frame.clusters->getMappedMemory()), CLUSTER_COUNT, ClusterData{0, 0});
+
+            reserveLights(frameIndex, INITIAL_LIGHT_CAPACITY);
+            reserveLightIndices(frameIndex, INITIAL_INDEX_CAPACITY);
+            writeDescriptorSet(frameIndex);
+        }
+    }
+
+    void LightClusterSystem::reserveLights(uint32_t frameIndex, uint32_t count) {
+        FrameResources &frame = frames[frameIndex];
+        if (frame.lights && frame.lights->getInstanceCount() >= count) return;
+
+        // The frame using these buffers last has already been waited on by Renderer::beginFrame, so they can go
+        uint32_t capacity = frame.lights ? frame.lights->getInstanceCount() : INITIAL_LIGHT_CAPACITY;
+        while (capacity < count) capacity *= 2;
+
+        frame.lights = std::make_unique<Buffer>(device,
+                                                sizeof(LightData),
+                                                capacity,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                1,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.lights->map();
+        if (frame.lightSet != VK_NULL_HANDLE) writeDescriptorSet(frameIndex);
+    }
+
+    void LightClusterSystem::reserveLightIndices(uint32_t frameIndex, uint32_t count) {
+        FrameResources &frame = frames[frameIndex];
+        if (frame.lightIndices && frame.lightIndices->getInstanceCount() >= count) return;
+
+        uint32_t capacity = frame.lightIndices ? frame.lightIndices->getInstanceCount() : INITIAL_INDEX_CAPACITY;
+        while (capacity < count) capacity *= 2;
+
+        frame.lightIndices = std::make_unique<Buffer>(device,
+                                                      sizeof(uint32_t),
+                                                      capacity,
+                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                      1,
+                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.lightIndices->map();
+        if (frame.lightSet != VK_NULL_HANDLE) writeDescriptorSet(frameIndex);
+    }
+
+    void LightClusterSystem::writeDescriptorSet(uint32_t frameIndex) {
+        FrameResources &frame = frames[frameIndex];
+
+        std::array<VkDescriptorBufferInfo, 3> bufferInfos{frame.lights->descriptorInfo(),
+                                                          frame.clusters->descriptorInfo(),
+                                                          frame.lightIndices->descriptorInfo()};
+        DescriptorWriter writer{*setLayout, *descriptorPool};
+        for (uint32_t binding = 0; binding < bufferInfos.size(); binding++) writer.writeBuffer(binding, &bufferInfos[binding]);
+        if (frame.lightSet == VK_NULL_HANDLE) {
+            if (!writer.build(frame.lightSet)) throw std::runtime_error("Failed to allocate light descriptor set!");
+        } else writer.overwrite(frame.lightSet);
+    }
+
+    void LightClusterSystem::update(FrameInfo &frameInfo, GlobalUbo &ubo, VkExtent2D extent) {
+        FrameResources &frame = frames[frameInfo.frameIndex];
+        const Camera &camera = frameInfo.camera;
+        const glm::mat4 viewMatrix = camera.getViewMatrix();
+        const float near = camera.getNearPlane();
+        const float far = camera.getFarPlane();
+        stats = {};
+
+        // Gather every light, in world space for the shaders and in view space for the assignment
+        auto lights = frameInfo.registry.view<TransformComponent, PointLightComponent>();
+        reserveLights(frameInfo.frameIndex, static_cast<uint32_t>(lights.size()));
+        auto *lightData = static_cast<LightData*>(frame.lights->getMappedMemory());
+
+        viewLights.clear();
+        lights.each([&](TransformComponent &transform, PointLightComponent &pointLight) {
+            const glm::vec4 position = transform.mat4()[3]; // Interpolated world position
+            lightData[viewLights.size()] = {glm::vec4{glm::vec3{position}, pointLight.radius},
+                                            glm::vec4{pointLight.color, pointLight.intensity}};
+            viewLights.push_back({glm::vec3{viewMatrix * position}, pointLight.radius});
+        });
+        stats.lightCount = static_cast<uint32_t>(viewLights.size());
+
+        // Depth slices don't share any cluster, so each of them can be filled on its own
+        const glm::mat4 projection = camera.getProjectionMatrix();
+        threadPool.parallelFor(CLUSTERS_Z, 1, [&](size_t begin, size_t end) {
+            for (size_t slice = begin; slice < end; slice++) assignSlice(static_cast<uint32_t>(slice), projection, near, far);
+        });
+
+        // Pack the per cluster lists one after the other
+        uint32_t indexCount = 0;
+        for (const auto &cluster : clusterLights) indexCount += static_cast<uint32_t>(cluster.size());
+        reserveLightIndices(frameInfo.frameIndex, indexCount);
+
+        auto *clusters = static_cast<ClusterData*>(frame.clusters->getMappedMemory());
+        auto *lightIndices = static_cast<uint32_t*>(frame.lightIndices->getMappedMemory());
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < CLUSTER_COUNT; i++) {
+            const auto count = static_cast<uint32_t>(clusterLights[i].size());
+            std::copy(clusterLights[i].begin(), clusterLights[i].end(), lightIndices + offset);
+            clusters[i] = {offset, count};
+            offset += count;
+            stats.maxLightsPerCluster = std::max(stats.maxLightsPerCluster, count);
+        } stats.lightIndexCount = indexCount;
+
+        // Slice of a view depth z: log(z) * scale + bias, see assignSlice
+        const float logDepthRange = std::log(far / near);
+        ubo.clusterParams = {static_cast<float>(CLUSTERS_X) / static_cast<float>(extent.width),
+                             static_cast<float>(CLUSTERS_Y) / static_cast<float>(extent.height),
+                             static_cast<float>(CLUSTERS_Z) / logDepthRange,
+                             -static_cast<float>(CLUSTERS_Z) * std::log(near) / logDepthRange};
+        ubo.clusterGrid = {CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, stats.lightCount};
+    }
+
+    void LightClusterSystem::assignSlice(uint32_t slice, const glm::mat4 &projection, float near, float far) {
+        // Exponential slices, each one is as deep as it is far from the previous one, so clusters stay roughly cubic
+        const float depthRatio = far / near;
+        const float sliceNear = near * std::pow(depthRatio, static_cast<float>(slice) / CLUSTERS_Z);
+        const float sliceFar = near * std::pow(depthRatio, static_cast<float>(slice + 1) / CLUSTERS_Z);
+
+        const uint32_t firstCluster = slice * CLUSTERS_X * CLUSTERS_Y;
+        for (uint32_t i = 0; i < CLUSTERS_X * CLUSTERS_Y; i++) clusterLights[firstCluster + i].clear();
+
+        for (uint32_t light = 0; light < viewLights.size(); light++) {
+            const glm::vec3 &center = viewLights[light].center;
+            const float radius = viewLights[light].radius;
+
+            // The part of the light's bounding box inside this slice
+            const float boxNear = std::max(sliceNear, center.z - radius);
+            const float boxFar = std::min(sliceFar, center.z + radius);
+            if (boxNear > boxFar) continue;
+
+            const auto [firstX, lastX] = tileRange(center.x - radius, center.x + radius, boxNear, boxFar, projection[0][0], CLUSTERS_X);
+            const auto [firstY, lastY] = tileRange(center.y - radius, center.y + radius, boxNear, boxFar, projection[1][1], CLUSTERS_Y);
+            for (int y = firstY; y <= lastY; y++)
+                for (int x = firstX; x <= lastX; x++)
+                    clusterLights[firstCluster + static_cast<uint32_t>(y) * CLUSTERS_X + static_cast<uint32_t>(x)].push_back(light);
+        }
+    }
+}
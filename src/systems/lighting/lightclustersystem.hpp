@@ -0,0 +1,95 @@
+#ifndef LIGHTCLUSTERSYSTEM_HPP
+#define LIGHTCLUSTERSYSTEM_HPP
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <array>
+
+#include "../../utils/device/device.hpp"
+#include "../../utils/buffer/buffer.hpp"
+#include "../../utils/descriptors/descriptors.hpp"
+#include "../../utils/swapchain/swapchain.hpp"
+#include "../../utils/frameinfo/frameinfo.hpp"
+#include "../../utils/jobs/threadpool.hpp"
+
+namespace Engine {
+    // Clustered forward lighting. The view frustum is split into a grid of clusters, screen tiles along x and y and
+    // depth slices growing exponentially along z, and every frame each point light is assigned to the clusters its
+    // range touches. Fragments then only loop over the lights of their own cluster.
+    // Assignment runs on the CPU, one depth slice per task across the thread pool, testing each light's bounding box
+    // against the slice and the screen tiles it projects to. The results go into per-frame storage buffers:
+    //   binding 0: every light (position and radius, color and intensity)
+    //   binding 1: per cluster, the offset and count of its lights in binding 2
+    //   binding 2: light indices, grouped by cluster
+    // Assumes a perspective projection.
+    class LightClusterSystem {
+    public:
+        static constexpr uint32_t CLUSTERS_X = 16;
+        static constexpr uint32_t CLUSTERS_Y = 9;
+        static constexpr uint32_t CLUSTERS_Z = 24;
+        static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+        struct Stats {
+            uint32_t lightCount = 0;
+            uint32_t lightIndexCount = 0; // Light to cluster assignments
+            uint32_t maxLightsPerCluster = 0;
+        };
+
+        LightClusterSystem(Device &device, ThreadPool &threadPool);
+
+        LightClusterSystem(const LightClusterSystem &) = delete;
+        LightClusterSystem &operator=(const LightClusterSystem &) = delete;
+
+        // Gathers and assigns the lights of the frame, and fills the cluster parameters of the ubo. Needs the camera of
+        // the frame to be set up already.
+        void update(FrameInfo &frameInfo, GlobalUbo &ubo, VkExtent2D extent);
+
+        VkDescriptorSetLayout getSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+        VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const { return frames[frameIndex].lightSet; }
+
+        const Stats &getStats() const { return stats; }
+    private:
+        static constexpr uint32_t INITIAL_LIGHT_CAPACITY = 1024;
+        static constexpr uint32_t INITIAL_INDEX_CAPACITY = 16 * 1024;
+
+        // View space bounds of a light, what the assignment works on
+        struct ViewLight {
+            glm::vec3 center;
+            float radius;
+        };
+
+        struct FrameResources {
+            std::unique_ptr<Buffer> lights;
+            std::unique_ptr<Buffer> clusters;
+            std::unique_ptr<Buffer> lightIndices;
+            VkDescriptorSet lightSet = VK_NULL_HANDLE;
+        };
+
+        Device &device;
+        ThreadPool &threadPool;
+
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        std::unique_ptr<DescriptorPool> descriptorPool;
+        std::array<FrameResources, SwapChain::MAX_FRAMES_IN_FLIGHT> frames{};
+
+        std::vector<ViewLight> viewLights;
+        std::vector<std::vector<uint32_t>> clusterLights; // Per cluster, kept around so they don't reallocate every frame
+        Stats stats{};
+
+        void createDescriptorResources();
+
+        // Make sure the buffers of a frame fit `count` lights or light indices, they are only ever grown
+        void reserveLights(uint32_t frameIndex, uint32_t count);
+        void reserveLightIndices(uint32_t frameIndex, uint32_t count);
+        void writeDescriptorSet(uint32_t frameIndex);
+
+        void assignSlice(uint32_t slice, const glm::mat4 &projection, float near, float far);
+    };
+}
+
+#endif
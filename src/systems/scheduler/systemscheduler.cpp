@@ -0,0 +1,105 @@
+#include "systemscheduler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Engine {
+    SystemScheduler::SystemId SystemScheduler::addSystem(SystemDesc desc, std::function<void(FrameInfo&)> func) {
+        const auto id = static_cast<SystemId>(systems.size());
+        for (SystemId dependency : desc.after)
+            if (dependency >= id) throw std::runtime_error("Systems can only depend on systems added before them!");
+
+        systems.push_back({std::move(desc), std::move(func)});
+        graphDirty = true;
+        return id;
+    }
+
+    bool SystemScheduler::conflicts(const SystemDesc &a, const SystemDesc &b) {
+        return (a.writes & (b.reads | b.writes)) || (b.writes & a.reads);
+    }
+
+    void SystemScheduler::buildGraph() {
+        for (auto &system : systems) {
+            system.dependents.clear();
+            system.dependencyCount = 0;
+        }
+
+        // Edges always go from an earlier system to a later one, so the graph can't have cycles
+        for (SystemId later = 0; later < systems.size(); later++) {
+            System &system = systems[later];
+            for (SystemId earlier = 0; earlier < later; earlier++) {
+                const auto &explicitDeps = system.desc.after;
+                const bool explicitDep = std::find(explicitDeps.begin(), explicitDeps.end(), earlier) != explicitDeps.end();
+                if (!explicitDep && !conflicts(systems[earlier].desc, system.desc)) continue;
+
+                systems[earlier].dependents.push_back(later);
+                system.dependencyCount++;
+            }
+        }
+
+        // Systems are already in topological order, so the longest chain comes out of a single pass
+        std::vector<uint32_t> depths(systems.size(), 1);
+        criticalPathLength = 0;
+        for (SystemId id = 0; id < systems.size(); id++) {
+            for (SystemId dependent : systems[id].dependents) depths[dependent] = std::max(depths[dependent], depths[id] + 1);
+            criticalPathLength = std::max(criticalPathLength, depths[id]);
+        }
+
+        pendingDependencies = std::make_unique<std::atomic<uint32_t>[]>(systems.size());
+        graphDirty = false;
+    }
+
+    void SystemScheduler::run(FrameInfo &frameInfo) {
+        if (systems.empty()) return;
+        if (graphDirty) buildGraph();
+
+        firstException = nullptr;
+        mainThreadQueue.clear();
+        remaining.store(systems.size(), std::memory_order_relaxed);
+        for (SystemId id = 0; id < systems.size(); id++)
+            pendingDependencies[id].store(systems[id].dependencyCount, std::memory_order_relaxed);
+
+        for (SystemId id = 0; id < systems.size(); id++)
+            if (systems[id].dependencyCount == 0) schedule(id, frameInfo);
+
+        // Main thread systems are only ever run from here, the rest of the time this thread helps the workers
+        while (remaining.load(std::memory_order_acquire) > 0)
+            if (!runMainThreadSystem(frameInfo) && !threadPool.runPendingTask()) std::this_thread::yield();
+
+        if (firstException) std::rethrow_exception(firstException);
+    }
+
+    void SystemScheduler::schedule(SystemId id, FrameInfo &frameInfo) {
+        if (systems[id].desc.mainThread) {
+            std::lock_guard<std::mutex> lock{mainThreadMutex};
+            mainThreadQueue.push_back(id);
+            return;
+        } threadPool.submit([this, id, &frameInfo] { runSystem(id, frameInfo); });
+    }
+
+    bool SystemScheduler::runMainThreadSystem(FrameInfo &frameInfo) {
+        SystemId id;
+        {
+            std::lock_guard<std::mutex> lock{mainThreadMutex};
+            if (mainThreadQueue.empty()) return false;
+
+            id = mainThreadQueue.back();
+            mainThreadQueue.pop_back();
+        } runSystem(id, frameInfo);
+        return true;
+    }
+
+    void SystemScheduler::runSystem(SystemId id, FrameInfo &frameInfo) {
+        try {
+            systems[id].func(frameInfo);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock{exceptionMutex};
+            if (!firstException) firstException = std::current_exception();
+        }
+
+        for (SystemId dependent : systems[id].dependents)
+            if (pendingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) schedule(dependent, frameInfo);
+
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
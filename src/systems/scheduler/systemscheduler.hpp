@@ -0,0 +1,78 @@
+#ifndef SYSTEMSCHEDULER_HPP
+#define SYSTEMSCHEDULER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <exception>
+
+#include "../../utils/frameinfo/frameinfo.hpp"
+#include "../../utils/jobs/threadpool.hpp"
+
+namespace Engine {
+    // Runs the per-frame systems on the thread pool, in parallel whenever they don't touch the same components.
+    // Every system declares the component types it reads and writes. Two systems conflict if one of them writes something
+    // the other one reads or writes, conflicting systems run in the order they were added, everything else is free to
+    // overlap. State living outside the registry (the camera, the global ubo, ...) is ordered through explicit dependencies.
+    class SystemScheduler {
+    public:
+        typedef uint32_t SystemId;
+
+        struct SystemDesc {
+            std::string name;
+            ComponentType_t reads = 0;
+            ComponentType_t writes = 0;
+            bool mainThread = false; // For systems that have to stay on the thread calling run(), like GLFW input
+            std::vector<SystemId> after{}; // Systems that must have finished first, they must have been added before
+        };
+
+        explicit SystemScheduler(ThreadPool &threadPool) : threadPool(threadPool) {}
+
+        SystemScheduler(const SystemScheduler &) = delete;
+        SystemScheduler &operator=(const SystemScheduler &) = delete;
+
+        SystemId addSystem(SystemDesc desc, std::function<void(FrameInfo&)> func);
+
+        // Runs every system once and returns when all of them are done. The calling thread runs the main thread systems
+        // and helps with the rest. If a system throws, the first exception is rethrown once the frame is done.
+        void run(FrameInfo &frameInfo);
+
+        size_t getSystemCount() const { return systems.size(); }
+        const std::string &getSystemName(SystemId id) const { return systems[id].desc.name; }
+        // Length of the longest dependency chain, the best case number of sequential steps per frame
+        uint32_t getCriticalPathLength() const { return criticalPathLength; }
+    private:
+        struct System {
+            SystemDesc desc;
+            std::function<void(FrameInfo&)> func;
+            std::vector<SystemId> dependents{};
+            uint32_t dependencyCount = 0;
+        };
+
+        ThreadPool &threadPool;
+        std::vector<System> systems;
+        bool graphDirty = true;
+        uint32_t criticalPathLength = 0;
+
+        // Per-run state
+        std::unique_ptr<std::atomic<uint32_t>[]> pendingDependencies;
+        std::atomic<size_t> remaining{0};
+        std::vector<SystemId> mainThreadQueue;
+        std::mutex mainThreadMutex;
+        std::exception_ptr firstException;
+        std::mutex exceptionMutex;
+
+        static bool conflicts(const SystemDesc &a, const SystemDesc &b);
+
+        void buildGraph();
+        void schedule(SystemId id, FrameInfo &frameInfo);
+        void runSystem(SystemId id, FrameInfo &frameInfo);
+        bool runMainThreadSystem(FrameInfo &frameInfo);
+    };
+}
+
+#endif
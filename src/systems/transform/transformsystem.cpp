@@ -0,0 +1,173 @@
+#include "transformsystem.hpp"
+
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Engine {
+    void TransformSystem::update(Registry &registry, float alpha) {
+        stats = {};
+        if (registry.getStructureVersion() != hierarchyVersion) rebuildHierarchy(registry);
+
+        updateRoots(registry, alpha);
+        updateHierarchy(registry, alpha);
+
+        stats.hierarchyNodeCount = static_cast<uint32_t>(nodes.size());
+        stats.hierarchyDepth = levelOffsets.empty() ? 0 : static_cast<uint32_t>(levelOffsets.size() - 1);
+    }
+
+    void TransformSystem::beginStep(Registry &registry) {
+        registry.view<TransformComponent>().eachArchetype([&](Archetype &archetype) {
+            TransformComponent *transforms = archetype.column<TransformComponent>();
+            threadPool.parallelFor(archetype.size(), MIN_NODES_PER_TASK, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) transforms[i].beginStep();
+            });
+        });
+    }
+
+    void TransformSystem::updateRoots(Registry &registry, float alpha) {
+        // Anything without a parent is updated straight from the archetype columns
+        batch.clear();
+        registry.view<TransformComponent>().eachArchetype([&](Archetype &archetype) {
+            if (archetype.hasComponent(ComponentType::HIERARCHY)) return;
+
+            TransformComponent *transforms = archetype.column<TransformComponent>();
+            for (size_t i = 0; i < archetype.size(); i++)
+                if (transforms[i].needsUpdate()) batch.push(transforms[i], alpha);
+            stats.transformCount += static_cast<uint32_t>(archetype.size());
+        });
+
+        stats.recomputedCount += static_cast<uint32_t>(batch.size());
+        flushBatch(alpha);
+    }
+
+    void TransformSystem::flushBatch(float alpha) {
+        if (batch.size() < MIN_KERNEL_BATCH) {
+            for (TransformComponent *transform : batch.transforms) transform->updateMatrices(alpha);
+            return;
+        }
+
+        batch.models.resize(batch.size());
+        batch.normals.resize(batch.size());
+
+        threadPool.parallelFor(batch.size(), MIN_NODES_PER_TASK, [&](size_t begin, size_t end) {
+            const TransformKernel::TransformArrays arrays{
+                batch.positionX.data() + begin, batch.positionY.data() + begin, batch.positionZ.data() + begin,
+                batch.rotationX.data() + begin, batch.rotationY.data() + begin, batch.rotationZ.data() + begin,
+                batch.scaleX.data() + begin, batch.scaleY.data() + begin, batch.scaleZ.data() + begin,
+            };
+            TransformKernel::computeMatrices(arrays, end - begin, batch.models.data() + begin,
+                                             batch.normals.data() + begin);
+
+            for (size_t i = begin; i < end; i++) batch.transforms[i]->setMatrices(batch.models[i], batch.normals[i]);
+        });
+    }
+
+    void TransformSystem::Batch::clear() {
+        transforms.clear();
+        positionX.clear(); positionY.clear(); positionZ.clear();
+        rotationX.clear(); rotationY.clear(); rotationZ.clear();
+        scaleX.clear(); scaleY.clear(); scaleZ.clear();
+    }
+
+    void TransformSystem::Batch::push(TransformComponent &transform, float alpha) {
+        const auto [position, scale, rotation] = transform.interpolate(alpha);
+
+        transforms.push_back(&transform);
+        positionX.push_back(position.x); positionY.push_back(position.y); positionZ.push_back(position.z);
+        rotationX.push_back(rotation.x); rotationY.push_back(rotation.y); rotationZ.push_back(rotation.z);
+        scaleX.push_back(scale.x); scaleY.push_back(scale.y); scaleZ.push_back(scale.z);
+    }
+
+    void TransformSystem::updateHierarchy(Registry &registry, float alpha) {
+        std::atomic<uint32_t> recomputed{0};
+
+        for (size_t level = 0; level + 1 < levelOffsets.size(); level++) {
+            const uint32_t levelBegin = levelOffsets[level];
+            const uint32_t levelSize = levelOffsets[level + 1] - levelBegin;
+
+            threadPool.parallelFor(levelSize, MIN_NODES_PER_TASK, [&](size_t begin, size_t end) {
+                uint32_t localRecomputed = 0;
+                for (size_t i = levelBegin + begin; i < levelBegin + end; i++) {
+                    Node &node = nodes[i];
+                    auto &transform = registry.getComponent<TransformComponent>(node.entity);
+
+                    if (node.parent == Entity::NULL_ID) {
+                        if (transform.updateMatrices(alpha)) localRecomputed++;
+                        continue;
+                    }
+
+                    const auto &parent = registry.getComponent<TransformComponent>(node.parent);
+                    if (!transform.needsUpdate() && parent.getVersion() == node.parentVersion) continue;
+
+                    transform.updateMatrices(parent, alpha);
+                    node.parentVersion = parent.getVersion();
+                    localRecomputed++;
+                } recomputed.fetch_add(localRecomputed, std::memory_order_relaxed);
+            });
+        }
+
+        stats.transformCount += static_cast<uint32_t>(nodes.size());
+        stats.recomputedCount += recomputed.load();
+    }
+
+    void TransformSystem::rebuildHierarchy(Registry &registry) {
+        constexpr uint32_t UNSET = std::numeric_limits<uint32_t>::max();
+
+        std::vector<Entity::id_t> entities;
+        std::vector<Entity::id_t> parents;
+        registry.view<TransformComponent, HierarchyComponent>().eachWithId([&](Entity::id_t id,
+                                                                              TransformComponent &,
+                                                                              HierarchyComponent &hierarchy) {
+            entities.push_back(id);
+            parents.push_back(hierarchy.getParent());
+        });
+
+        const auto count = static_cast<uint32_t>(entities.size());
+        std::unordered_map<Entity::id_t, uint32_t> indices;
+        indices.reserve(count);
+        for (uint32_t i = 0; i < count; i++) indices[entities[i]] = i;
+
+        // Depth of every node, walking up the chain of parents until reaching one whose depth is already known
+        std::vector<uint32_t> depths(count, UNSET);
+        std::vector<uint32_t> chain;
+        uint32_t maxDepth = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t current = i;
+            while (depths[current] == UNSET) {
+                auto parent = indices.find(parents[current]);
+                if (parent == indices.end()) {
+                    // The parent isn't part of the hierarchy itself, so this node hangs from a root
+                    if (!registry.isAlive(parents[current]) ||
+                        !(registry.getComponentMask(parents[current]) & (1 << ComponentType::TRANSFORM)))
+                        parents[current] = Entity::NULL_ID;
+                    depths[current] = 0;
+                    break;
+                }
+
+                chain.push_back(current);
+                current = parent->second;
+                if (chain.size() > count) throw std::runtime_error("Cycle found in the transform hierarchy!");
+            }
+
+            uint32_t depth = depths[current];
+            while (!chain.empty()) {
+                depths[chain.back()] = ++depth;
+                chain.pop_back();
+            } maxDepth = std::max(maxDepth, depth);
+        }
+
+        // Counting sort by depth, so each level ends up contiguous
+        levelOffsets.assign(count > 0 ? maxDepth + 2 : 0, 0);
+        for (uint32_t i = 0; i < count; i++) levelOffsets[depths[i] + 1]++;
+        for (size_t level = 1; level < levelOffsets.size(); level++) levelOffsets[level] += levelOffsets[level - 1];
+
+        nodes.resize(count);
+        std::vector<uint32_t> cursors(levelOffsets.begin(), levelOffsets.end());
+        for (uint32_t i = 0; i < count; i++)
+            nodes[cursors[depths[i]]++] = {entities[i], parents[i], 0}; // Version 0 forces a recompute
+
+        hierarchyVersion = registry.getStructureVersion();
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef TRANSFORMSYSTEM_HPP
+#define TRANSFORMSYSTEM_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "../../utils/entity/entity.hpp"
+#include "../../utils/jobs/threadpool.hpp"
+#include "../../utils/math/transformkernel.hpp"
+
+namespace Engine {
+    // Rebuilds the cached model and normal matrices of every transform that changed since the last frame.
+    // Static entities only cost a flag check. Dirty roots are gathered into structure of arrays scratch buffers and
+    // rebuilt in batches by the SIMD transform kernel.
+    // Entities with a HierarchyComponent are kept in a flat array sorted by depth, so parents always come before their
+    // children and world matrices come out of one linear sweep. Nodes on the same depth level don't depend on each
+    // other, so every level is split across the thread pool. A child is only recomputed when it or its parent changed.
+    class TransformSystem {
+    public:
+        struct Stats {
+            uint32_t transformCount = 0; // Transforms visited in the last update
+            uint32_t recomputedCount = 0; // Transforms whose matrices were rebuilt in the last update
+            uint32_t hierarchyNodeCount = 0; // Transforms attached to a parent
+            uint32_t hierarchyDepth = 0;
+        };
+
+        explicit TransformSystem(ThreadPool &threadPool) : threadPool(threadPool) {}
+
+        TransformSystem(const TransformSystem &) = delete;
+        TransformSystem &operator=(const TransformSystem &) = delete;
+
+        // Rebuilds the matrices from the pose interpolated between the last two simulation steps (see FixedTimestep)
+        void update(Registry &registry, float alpha = 1.0f);
+
+        // Saves the current state of every transform as the one to interpolate from, call it before each simulation step
+        void beginStep(Registry &registry);
+
+        const Stats &getStats() const { return stats; }
+    private:
+        static constexpr size_t MIN_NODES_PER_TASK = 1024;
+        static constexpr size_t MIN_KERNEL_BATCH = 8; // Below this, gathering costs more than the kernel saves
+
+        // Dirty roots waiting for the kernel, as structure of arrays
+        struct Batch {
+            std::vector<TransformComponent*> transforms;
+            std::vector<float> positionX, positionY, positionZ;
+            std::vector<float> rotationX, rotationY, rotationZ;
+            std::vector<float> scaleX, scaleY, scaleZ;
+            std::vector<glm::mat4> models;
+            std::vector<glm::mat3> normals;
+
+            size_t size() const { return transforms.size(); }
+            void clear();
+            void push(TransformComponent &transform, float alpha);
+        };
+
+        struct Node {
+            Entity::id_t entity;
+            Entity::id_t parent; // Entity::NULL_ID if the parent is gone, the node is then treated as a root
+            uint32_t parentVersion; // Version of the parent transform the cached matrices were built from
+        };
+
+        ThreadPool &threadPool;
+        Stats stats{};
+        Batch batch{};
+
+        std::vector<Node> nodes; // Sorted by depth
+        std::vector<uint32_t> levelOffsets; // Level d spans [levelOffsets[d], levelOffsets[d + 1])
+        uint64_t hierarchyVersion = UINT64_MAX; // Registry structure version the nodes were built for
+
+        void rebuildHierarchy(Registry &registry);
+        void updateRoots(Registry &registry, float alpha);
+        void flushBatch(float alpha);
+        void updateHierarchy(Registry &registry, float alpha);
+    };
+}
+
+#endif
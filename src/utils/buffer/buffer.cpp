@@ -27,7 +27,8 @@ namespace Engine {
                    uint32_t instanceCount,
                    VkBufferUsageFlags usageFlags,
                    VkMemoryPropertyFlags memoryPropertyFlags,
-                   VkDeviceSize minOffsetAlignment)
+                   VkDeviceSize minOffsetAlignment,
+                   VkMemoryPropertyFlags preferredMemoryPropertyFlags)
                    : device{device},
                      instanceCount{instanceCount},
                      instanceSize{instanceSize},
@@ -35,18 +36,20 @@ namespace Engine {
                      memoryPropertyFlags{memoryPropertyFlags} {
         alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         bufferSize = alignmentSize * instanceCount;
-        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory, preferredMemoryPropertyFlags);
     }
 
     Buffer::~Buffer() {
         unmap();
         vkDestroyBuffer(device.device(), buffer, nullptr);
-        vkFreeMemory(device.device(), memory, nullptr);
+        device.getAllocator().free(memory);
     }
 
     /**
     * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
     *
+    * @note Host visible memory stays mapped by the allocator, this only points mapped at it
+    *
     * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
     * buffer range.
     * @param offset (Optional) Byte offset from beginning
@@ -54,8 +57,11 @@ namespace Engine {
     * @return VkResult of the buffer mapping call
     */
     VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(device.device(), memory, offset, size, 0, &mapped);
+        assert(buffer && memory.memory && "Called map on buffer before create");
+        if (!memory.mapped) return VK_ERROR_MEMORY_MAP_FAILED;
+
+        mapped = static_cast<char*>(memory.mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
@@ -64,10 +70,7 @@ namespace Engine {
     * @note Does not return a result as vkUnmapMemory can't fail
     */
     void Buffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(device.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
     }
 
     /**
@@ -102,12 +105,7 @@ namespace Engine {
     * @return VkResult of the flush call
     */
     VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(device.device(), 1, &mappedRange);
+        return device.getAllocator().flush(memory, offset, size);
     }
 
     /**
@@ -122,12 +120,7 @@ namespace Engine {
     * @return VkResult of the invalidate call
     */
     VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(device.device(), 1, &mappedRange);
+        return device.getAllocator().invalidate(memory, offset, size);
     }
 
     /**
@@ -14,7 +14,8 @@ namespace Engine {
                uint32_t instanceCount,
                VkBufferUsageFlags usageFlags,
                VkMemoryPropertyFlags memoryPropertyFlags,
-               VkDeviceSize minOffsetAlignment = 1);
+               VkDeviceSize minOffsetAlignment = 1,
+               VkMemoryPropertyFlags preferredMemoryPropertyFlags = 0);
         ~Buffer();
 
         Buffer(const Buffer&) = delete;
@@ -40,6 +41,9 @@ namespace Engine {
         VkDeviceSize getAlignmentSize() const { return alignmentSize; }
         VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
         VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
+        // Whether the memory it ended up in can be mapped, preferred properties included
+        bool isHostVisible() const { return memory.mapped != nullptr; }
+        uint32_t getMemoryType() const { return memory.memoryType; }
         VkDeviceSize getBufferSize() const { return bufferSize; }
 
     private:
@@ -48,7 +52,7 @@ namespace Engine {
         Device& device;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        MemoryAllocator::Allocation memory;
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
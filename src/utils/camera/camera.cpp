@@ -21,6 +21,9 @@ namespace Engine {
 
         projectionMatrix[3][2] = (far + near) * fn;
         projectionMatrix[3][3] = 1.0f;
+
+        nearPlane = near;
+        farPlane = far;
     }
 
     void Camera::setOrthographicProjection(float left, float right, float top, float bottom, float near, float far) {
@@ -42,6 +45,9 @@ namespace Engine {
         projectionMatrix[3][1] = (bottom + top) * -bt;
         projectionMatrix[3][2] = near * -fn;
         projectionMatrix[3][3] = 1.0f;
+
+        nearPlane = near;
+        farPlane = far;
     }
 
     void Camera::setPerspectiveProjection(float fov, float aspect, float near, float far) {
@@ -59,6 +65,9 @@ namespace Engine {
         // TODO(Dory): Check if this is a bug in GLM or if I'm just doing something wrong
         projectionMatrix[2][2] *= -1.0f;
         projectionMatrix[2][3] *= -1.0f;
+
+        nearPlane = near;
+        farPlane = far;
     }
 
     void Camera::setViewTarget(glm::vec3 position, glm::vec3 target, glm::vec3 up) {
@@ -144,4 +153,24 @@ namespace Engine {
         inverseViewMatrix[3][1] = position.y;
         inverseViewMatrix[3][2] = position.z;
     }
-}
\ No newline at end of file
+
+    std::array<glm::vec4, 6> Camera::getFrustumPlanes() const {
+        // Gribb-Hartmann: every plane is a combination of the rows of the view-projection matrix, straight from the clip
+        // space bounds (-w <= x <= w, -w <= y <= w, 0 <= z <= w)
+        const glm::mat4 viewProjection = projectionMatrix * viewMatrix;
+        auto row = [&](int i) {
+            return glm::vec4{viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]};
+        };
+
+        std::array<glm::vec4, 6> planes{
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(2),
+            row(3) - row(2),
+        };
+        for (auto &plane : planes) plane /= glm::length(glm::vec3{plane});
+        return planes;
+    }
+}
@@ -7,6 +7,7 @@
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/ext/matrix_clip_space.hpp"
 
+#include <array>
 #include <cassert>
 #include <limits>
 
@@ -29,10 +30,21 @@ namespace Engine {
         glm::mat4 getViewMatrix () const { return viewMatrix; }
         glm::mat4 getInverseViewMatrix () const { return inverseViewMatrix; }
 
+        // View space depth of the near and far planes of the last projection set
+        float getNearPlane() const { return nearPlane; }
+        float getFarPlane() const { return farPlane; }
+
+        // Left, right, bottom, top, near and far planes of the view frustum, in world space. Normals point inwards and
+        // are normalized, so dot(plane.xyz, point) + plane.w is the signed distance from the point to the plane
+        std::array<glm::vec4, 6> getFrustumPlanes() const;
+
     private:
         glm::mat4 projectionMatrix{1.0f};
         glm::mat4 viewMatrix{1.0f};
         glm::mat4 inverseViewMatrix{1.0f};
+
+        float nearPlane = 0.0f;
+        float farPlane = 1.0f;
     };
 }
 
@@ -4,7 +4,8 @@ namespace Engine {
     DescriptorSetLayout::Builder &DescriptorSetLayout::Builder::addBinding(uint32_t binding,
                                                                            VkDescriptorType descriptorType,
                                                                            VkShaderStageFlags stageFlags,
-                                                                           uint32_t count) {
+                                                                           uint32_t count,
+                                                                           VkDescriptorBindingFlags bindingFlags) {
         assert(bindings.count(binding) == 0 && "That binding is already in use");
         VkDescriptorSetLayoutBinding layoutBinding{};
         layoutBinding.binding = binding;
@@ -12,24 +13,44 @@ namespace Engine {
         layoutBinding.descriptorCount = count;
         layoutBinding.stageFlags = stageFlags;
         bindings[binding] = layoutBinding;
+        if (bindingFlags != 0) this->bindingFlags[binding] = bindingFlags;
         return *this;
     }
 
     std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const {
-        return std::make_unique<DescriptorSetLayout>(device, bindings);
+        return std::make_unique<DescriptorSetLayout>(device, bindings, bindingFlags);
     }
 
 // *************** Descriptor Set Layout *********************
 
     DescriptorSetLayout::DescriptorSetLayout(Device &device,
-                                             const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings) :
+                                             const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings,
+                                             const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags) :
                                              device{device}, bindings{bindings} {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{}; // Parallel to setLayoutBindings
         setLayoutBindings.reserve(bindings.size());
-        for (auto kv : bindings) setLayoutBindings.push_back(kv.second);
+        setLayoutBindingFlags.reserve(bindings.size());
+        VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
+        for (auto kv : bindings) {
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindings.push_back(kv.second);
+            setLayoutBindingFlags.push_back(flags == bindingFlags.end() ? 0 : flags->second);
+
+            // Update after bind bindings can only live in sets allocated from pools created for it
+            if (setLayoutBindingFlags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+                layoutFlags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
 
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        if (!bindingFlags.empty()) descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+        descriptorSetLayoutInfo.flags = layoutFlags;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
@@ -134,17 +155,18 @@ namespace Engine {
         return *this;
     }
 
-    DescriptorWriter &DescriptorWriter::writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo) {
+    DescriptorWriter &DescriptorWriter::writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo, uint32_t arrayElement) {
         assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain the specified binding");
 
         auto &bindingDescription = setLayout.bindings[binding];
 
-        assert(bindingDescription.descriptorCount == 1 && "Binding a single descriptor info, but the binding expects multiple");
+        assert(arrayElement < bindingDescription.descriptorCount && "Array element out of range for the binding");
 
         VkWriteDescriptorSet write{};
         write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         write.descriptorType = bindingDescription.descriptorType;
         write.dstBinding = binding;
+        write.dstArrayElement = arrayElement;
         write.pImageInfo = imageInfo;
         write.descriptorCount = 1;
 
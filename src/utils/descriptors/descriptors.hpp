@@ -16,18 +16,23 @@ namespace Engine {
         public:
             Builder(Device &device) : device{device} {}
 
+            // bindingFlags are VkDescriptorBindingFlags (partially bound, update after bind, ...), see VK_EXT_descriptor_indexing
             Builder &addBinding(uint32_t binding,
                                 VkDescriptorType descriptorType,
                                 VkShaderStageFlags stageFlags,
-                                uint32_t count = 1);
+                                uint32_t count = 1,
+                                VkDescriptorBindingFlags bindingFlags = 0);
             std::unique_ptr<DescriptorSetLayout> build() const;
 
         private:
             Device &device;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
         };
 
-        DescriptorSetLayout(Device &device, const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings);
+        DescriptorSetLayout(Device &device,
+                            const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings,
+                            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {});
         ~DescriptorSetLayout();
         DescriptorSetLayout(const DescriptorSetLayout &) = delete;
         DescriptorSetLayout &operator=(const DescriptorSetLayout &) = delete;
@@ -87,7 +92,8 @@ namespace Engine {
         DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool);
 
         DescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
-        DescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
+        // arrayElement picks the slot to write in array bindings
+        DescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo, uint32_t arrayElement = 0);
 
         bool build(VkDescriptorSet &set);
         void overwrite(VkDescriptorSet &set);
@@ -1,4 +1,5 @@
 #include "device.hpp"
+#include "../upload/uploadmanager.hpp"
 
 namespace Engine {
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -40,11 +41,15 @@ namespace Engine {
         createSurface();
         pickPhysicalDevice();
         createLogicalDevice();
+        allocator = std::make_unique<MemoryAllocator>(device_, physicalDevice, memoryBudgetEnabled);
         createCommandPool();
+        uploadManager = std::make_unique<UploadManager>(*this);
     }
 
     Device::~Device() {
+        uploadManager.reset();
         vkDestroyCommandPool(device_, commandPool, nullptr);
+        allocator.reset();
         vkDestroyDevice(device_, nullptr);
 
         if (enableValidationLayers) DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
@@ -122,6 +127,7 @@ namespace Engine {
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+        if (indices.transferFamilyHasValue) uniqueQueueFamilies.insert(indices.transferFamily);
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -137,15 +143,48 @@ namespace Engine {
         deviceFeatures.samplerAnisotropy = VK_TRUE;
         // deviceFeatures.fillModeNonSolid = VK_TRUE; // Enable wireframe rendering support
 
+        // Optional 1.2 features, only enabled when the device has them
+        VkPhysicalDeviceVulkan12Features supported12Features{};
+        supported12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        if (properties.apiVersion >= VK_API_VERSION_1_2) {
+            VkPhysicalDeviceFeatures2 supportedFeatures{};
+            supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            supportedFeatures.pNext = &supported12Features;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+        }
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+        // Indirect draws written by the GPU point at their instances through firstInstance, which is always 0 without
+        // drawIndirectFirstInstance, so it goes with drawIndirectCount or neither is used
+        VkPhysicalDeviceVulkan12Features enabled12Features{};
+        enabled12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        drawIndirectCountEnabled = supported12Features.drawIndirectCount && supportedFeatures.drawIndirectFirstInstance;
+        enabled12Features.drawIndirectCount = drawIndirectCountEnabled ? VK_TRUE : VK_FALSE;
+        deviceFeatures.drawIndirectFirstInstance = drawIndirectCountEnabled ? VK_TRUE : VK_FALSE;
+
+        // Required, the bindless texture table depends on them (see checkDescriptorIndexingSupport)
+        enabled12Features.runtimeDescriptorArray = VK_TRUE;
+        enabled12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        enabled12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        enabled12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        enabled12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+        // Optional extensions, only enabled when the device has them
+        std::vector<const char *> enabledExtensions = deviceExtensions;
+        memoryBudgetEnabled = checkDeviceExtensionSupport(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memoryBudgetEnabled) enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        if (properties.apiVersion >= VK_API_VERSION_1_2) createInfo.pNext = &enabled12Features;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -159,6 +198,10 @@ namespace Engine {
 
         vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+        // Without a transfer only family, uploads share the graphics queue
+        transferFamily_ = indices.transferFamilyHasValue ? indices.transferFamily : indices.graphicsFamily;
+        vkGetDeviceQueue(device_, transferFamily_, 0, &transferQueue_);
     }
 
     void Device::createCommandPool() {
@@ -194,7 +237,8 @@ namespace Engine {
         if (!indices.isComplete() ||
             !extensionsSupported ||
             !swapChainAdequate ||
-            !supportedFeatures.samplerAnisotropy) return 0;
+            !supportedFeatures.samplerAnisotropy ||
+            !checkDescriptorIndexingSupport(device)) return 0;
 
         switch (properties.deviceType) {
             case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
@@ -317,6 +361,42 @@ namespace Engine {
         return requiredExtensions.empty();
     }
 
+    bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device, const char *extensionName) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        return std::any_of(availableExtensions.begin(),
+                           availableExtensions.end(),
+                           [extensionName](const auto &extension) {
+            return std::strcmp(extension.extensionName, extensionName) == 0;
+        });
+    }
+
+    // Everything TextureTable needs: one unsized sampler array, partially filled, written while in use (slots not
+    // sampled by pending frames included) and indexed with values that differ between invocations. Core since
+    // Vulkan 1.2 (VK_EXT_descriptor_indexing before that).
+    bool Device::checkDescriptorIndexingSupport(VkPhysicalDevice device) {
+        VkPhysicalDeviceProperties deviceProperties{};
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+        if (deviceProperties.apiVersion < VK_API_VERSION_1_2) return false;
+
+        VkPhysicalDeviceVulkan12Features supported12Features{};
+        supported12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 supportedFeatures{};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures.pNext = &supported12Features;
+        vkGetPhysicalDeviceFeatures2(device, &supportedFeatures);
+
+        return supported12Features.runtimeDescriptorArray &&
+               supported12Features.descriptorBindingPartiallyBound &&
+               supported12Features.descriptorBindingSampledImageUpdateAfterBind &&
+               supported12Features.descriptorBindingUpdateUnusedWhilePending &&
+               supported12Features.shaderSampledImageArrayNonUniformIndexing;
+    }
+
     QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) const {
         QueueFamilyIndices indices;
 
@@ -341,6 +421,16 @@ namespace Engine {
             i++;
         }
 
+        for (uint32_t family = 0; family < queueFamilyCount; family++) {
+            const VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) &&
+                !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+                indices.transferFamily = family;
+                indices.transferFamilyHasValue = true;
+                break;
+            }
+        }
+
         return indices;
     }
 
@@ -380,19 +470,15 @@ namespace Engine {
     }
 
     uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-                return i;
-        throw std::runtime_error("Failed to find suitable memory type!");
+        return allocator->findMemoryType(typeFilter, properties);
     }
 
     void Device::createBuffer(VkDeviceSize size,
                               VkBufferUsageFlags usage,
                               VkMemoryPropertyFlags properties,
                               VkBuffer &buffer,
-                              VkDeviceMemory &bufferMemory) {
+                              MemoryAllocator::Allocation &bufferMemory,
+                              VkMemoryPropertyFlags preferredProperties) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
@@ -405,14 +491,10 @@ namespace Engine {
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-            throw std::runtime_error("Failed to allocate vertex buffer memory!");
-        vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+        const auto usageHint = usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT ? MemoryAllocator::Usage::STAGING
+                                                                         : MemoryAllocator::Usage::DEFAULT;
+        bufferMemory = allocator->allocate(memRequirements, properties, usageHint, true, preferredProperties);
+        allocator->bindBuffer(buffer, bufferMemory);
     }
 
     VkCommandBuffer Device::beginSingleTimeCommands() {
@@ -441,12 +523,36 @@ namespace Engine {
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue_);
+        // Only wait for this submission, not for everything else on the queue
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkFence fence;
+        if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create a fence!");
 
+        submit(graphicsQueue_, submitInfo, fence);
+        vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
+
+        vkDestroyFence(device_, fence, nullptr);
         vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
     }
 
+    std::mutex &Device::getQueueMutex(VkQueue queue) {
+        if (queue == graphicsQueue_) return graphicsQueueMutex;
+        if (queue == transferQueue_) return transferQueueMutex;
+        return presentQueueMutex;
+    }
+
+    VkResult Device::submit(VkQueue queue, const VkSubmitInfo &submitInfo, VkFence fence) {
+        std::lock_guard<std::mutex> lock{getQueueMutex(queue)};
+        return vkQueueSubmit(queue, 1, &submitInfo, fence);
+    }
+
+    VkResult Device::present(const VkPresentInfoKHR &presentInfo) {
+        std::lock_guard<std::mutex> lock{getQueueMutex(presentQueue_)};
+        return vkQueuePresentKHR(presentQueue_, &presentInfo);
+    }
+
     void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
@@ -488,22 +594,17 @@ namespace Engine {
     void Device::createImageWithInfo(const VkImageCreateInfo &imageInfo,
                                      VkMemoryPropertyFlags properties,
                                      VkImage &image,
-                                     VkDeviceMemory &imageMemory) {
+                                     MemoryAllocator::Allocation &imageMemory) {
         if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS)
             throw std::runtime_error("Failed to create image!");
 
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-            throw std::runtime_error("Failed to allocate image memory!");
-
-        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS)
-            throw std::runtime_error("Failed to bind image memory!");
+        imageMemory = allocator->allocate(memRequirements,
+                                          properties,
+                                          MemoryAllocator::Usage::DEFAULT,
+                                          imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
+        allocator->bindImage(image, imageMemory);
     }
 }
\ No newline at end of file
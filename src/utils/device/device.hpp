@@ -8,11 +8,16 @@
 #include <set>
 #include <unordered_set>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
 #include <vulkan/vulkan.h>
 
 #include "../window/window.hpp"
+#include "../memory/memoryallocator.hpp"
 
 namespace Engine {
+    class UploadManager;
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR capabilities;
         std::vector<VkSurfaceFormatKHR> formats;
@@ -22,9 +27,11 @@ namespace Engine {
     struct QueueFamilyIndices {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
+        uint32_t transferFamily; // Transfer only, usually backed by the DMA engines. Optional
 
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
+        bool transferFamilyHasValue = false;
         bool isComplete() const { return graphicsFamilyHasValue && presentFamilyHasValue; }
     };
 
@@ -41,7 +48,7 @@ namespace Engine {
         explicit Device(Window &window);
         ~Device();
 
-        Device(const Device &) = default;
+        Device(const Device &) = delete;
         Device& operator=(const Device &) = delete;
         Device(Device &&) = delete;
         Device& operator=(Device &&) = delete;
@@ -51,6 +58,18 @@ namespace Engine {
         VkSurfaceKHR surface() const { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        // The graphics queue when the device has no transfer only family
+        VkQueue transferQueue() { return transferQueue_; }
+        uint32_t transferFamily() const { return transferFamily_; }
+        bool hasDedicatedTransferQueue() const { return transferQueue_ != graphicsQueue_; }
+        MemoryAllocator &getAllocator() { return *allocator; }
+        UploadManager &getUploadManager() { return *uploadManager; }
+
+        // Vulkan 1.2 feature, needed to let the GPU decide how many indirect draws to run. Only enabled together with
+        // drawIndirectFirstInstance, so the draws it counts can have a non zero firstInstance
+        bool supportsDrawIndirectCount() const { return drawIndirectCountEnabled; }
+        // VK_EXT_memory_budget, lets the allocator report how much of each heap the process can really use
+        bool supportsMemoryBudget() const { return memoryBudgetEnabled; }
 
         VkFormatProperties getFormatProperties(VkFormat format) const {
             VkFormatProperties formatProperties;
@@ -64,12 +83,19 @@ namespace Engine {
         VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
         // Buffer Helper Functions
+        // Memory comes from the allocator, buffers only ever used as a copy source are treated as staging
         void createBuffer(
                 VkDeviceSize size,
                 VkBufferUsageFlags usage,
                 VkMemoryPropertyFlags properties,
                 VkBuffer &buffer,
-                VkDeviceMemory &bufferMemory);
+                MemoryAllocator::Allocation &bufferMemory,
+                VkMemoryPropertyFlags preferredProperties = 0);
+        // Queues need external synchronisation, every submission and present goes through these so any thread can do it
+        VkResult submit(VkQueue queue, const VkSubmitInfo &submitInfo, VkFence fence);
+        VkResult present(const VkPresentInfoKHR &presentInfo);
+
+        // Blocking, prefer the upload manager for anything that happens more than once
         VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -78,7 +104,7 @@ namespace Engine {
         void createImageWithInfo(const VkImageCreateInfo &imageInfo,
                                  VkMemoryPropertyFlags properties,
                                  VkImage &image,
-                                 VkDeviceMemory &imageMemory);
+                                 MemoryAllocator::Allocation &imageMemory);
 
     private:
         const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
@@ -94,6 +120,16 @@ namespace Engine {
         VkSurfaceKHR surface_;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
+        VkQueue transferQueue_;
+        uint32_t transferFamily_;
+        std::mutex graphicsQueueMutex; // Also guards the present queue when it's the same one
+        std::mutex presentQueueMutex;
+        std::mutex transferQueueMutex;
+        std::unique_ptr<MemoryAllocator> allocator;
+        std::unique_ptr<UploadManager> uploadManager;
+
+        bool drawIndirectCountEnabled = false;
+        bool memoryBudgetEnabled = false;
 
         void createInstance();
         void setupDebugMessenger();
@@ -109,7 +145,10 @@ namespace Engine {
         QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) const;
         static void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
         void hasGflwRequiredInstanceExtensions();
+        std::mutex &getQueueMutex(VkQueue queue);
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+        bool checkDeviceExtensionSupport(VkPhysicalDevice device, const char *extensionName);
+        bool checkDescriptorIndexingSupport(VkPhysicalDevice device);
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
     };
 } // Engine
@@ -0,0 +1,91 @@
+#include "archetype.hpp"
+#include "entity.hpp"
+
+#include <algorithm>
+
+namespace Engine {
+    // Indexed by ComponentType, keep it in the same order as the enum
+    static const std::array<ComponentInfo, 4> componentInfos{
+        ComponentInfo::of<TransformComponent>(),
+        ComponentInfo::of<ModelComponent>(),
+        ComponentInfo::of<PointLightComponent>(),
+        ComponentInfo::of<HierarchyComponent>(),
+    };
+
+    const ComponentInfo &Archetype::getComponentInfo(ComponentType type) {
+        assert(type < componentInfos.size() && "Component type has not been registered!");
+        return componentInfos[type];
+    }
+
+    bool Archetype::isRegistered(ComponentType type) {
+        return type < componentInfos.size();
+    }
+
+    Column::~Column() {
+        if (data) pool->release(data, capacity);
+    }
+
+    void Column::reallocate(size_t newCapacity, size_t count) {
+        assert(newCapacity >= count && "Cannot shrink a column below its size!");
+
+        std::byte *newData = pool->acquire(newCapacity);
+        for (size_t i = 0; i < count; i++)
+            info->moveConstruct(newData + i * info->size, data + i * info->size);
+
+        if (data) pool->release(data, capacity);
+        data = newData;
+        capacity = newCapacity;
+    }
+
+    Archetype::Archetype(ComponentType_t mask, ComponentPools &pools) : mask(mask) {
+        for (size_t i = 0; i < MAX_COMPONENT_TYPES; i++) {
+            auto type = static_cast<ComponentType>(i);
+            if (mask & (1 << type)) columns[type].init(getComponentInfo(type), pools[type]);
+        }
+    }
+
+    Archetype::~Archetype() {
+        for (auto &column : columns) {
+            if (!column.isActive()) continue;
+            for (size_t row = 0; row < entities.size(); row++) column.getInfo().destroy(column.get(row));
+        }
+    }
+
+    void Archetype::reserve(size_t count) {
+        if (count <= capacity) return;
+
+        const size_t newCapacity = ComponentPool::roundCapacity(count);
+        entities.reserve(newCapacity);
+        for (auto &column : columns)
+            if (column.isActive()) column.reallocate(newCapacity, entities.size());
+        capacity = newCapacity;
+    }
+
+    Archetype::row_t Archetype::pushEntity(uint32_t entity) {
+        if (entities.size() == capacity) reserve(std::max(capacity * 2, ComponentPool::MIN_CAPACITY));
+
+        entities.push_back(entity);
+        return static_cast<row_t>(entities.size() - 1);
+    }
+
+    uint32_t Archetype::removeRow(row_t row) {
+        assert(row < entities.size() && "Row out of range!");
+
+        const row_t last = static_cast<row_t>(entities.size() - 1);
+        if (row != last) {
+            for (auto &column : columns)
+                if (column.isActive()) column.getInfo().moveConstruct(column.get(row), column.get(last));
+            entities[row] = entities[last];
+        }
+
+        uint32_t moved = entities[row];
+        entities.pop_back();
+        return moved;
+    }
+
+    uint32_t Archetype::destroyRow(row_t row) {
+        for (auto &column : columns)
+            if (column.isActive()) column.getInfo().destroy(column.get(row));
+        return removeRow(row);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef ARCHETYPE_HPP
+#define ARCHETYPE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <array>
+#include <cassert>
+
+#include "component.hpp"
+#include "componentpool.hpp"
+
+namespace Engine {
+    // A column holds every component of a single type for all the entities of an archetype, tightly packed and
+    // aligned to a cache line, so systems can stream through it linearly. Its storage comes from the pool of its
+    // component type.
+    class Column {
+    public:
+        Column() = default;
+        ~Column();
+
+        Column(const Column &) = delete;
+        Column &operator=(const Column &) = delete;
+
+        void init(const ComponentInfo &componentInfo, ComponentPool &componentPool) {
+            info = &componentInfo;
+            pool = &componentPool;
+        }
+        bool isActive() const { return info != nullptr; }
+        const ComponentInfo &getInfo() const { return *info; }
+
+        void *get(size_t row) { return data + row * info->size; }
+        std::byte *getData() { return data; }
+
+        // Grows the column to newCapacity (a power of two), moving the first `count` components to the new storage
+        void reallocate(size_t newCapacity, size_t count);
+    private:
+        const ComponentInfo *info = nullptr;
+        ComponentPool *pool = nullptr;
+        std::byte *data = nullptr;
+        size_t capacity = 0;
+    };
+
+    // An archetype stores all the entities that share the exact same component mask, one column per component type.
+    // Row i of every column belongs to entities[i].
+    class Archetype {
+    public:
+        typedef uint32_t row_t;
+
+        Archetype(ComponentType_t mask, ComponentPools &pools);
+        ~Archetype();
+
+        Archetype(const Archetype &) = delete;
+        Archetype &operator=(const Archetype &) = delete;
+
+        ComponentType_t getMask() const { return mask; }
+        bool hasComponent(ComponentType type) const { return mask & (1 << type); }
+        size_t size() const { return entities.size(); }
+        bool empty() const { return entities.empty(); }
+
+        const std::vector<uint32_t> &getEntities() const { return entities; }
+
+        template<typename T>
+        T *column() {
+            assert(hasComponent(T::TYPE) && "Archetype does not have this component!");
+            return reinterpret_cast<T*>(columns[T::TYPE].getData());
+        }
+
+        void *getComponent(ComponentType type, row_t row) {
+            assert(hasComponent(type) && "Archetype does not have this component!");
+            return columns[type].get(row);
+        }
+
+        // Makes room for at least `count` entities, so pushing them doesn't have to grow the columns
+        void reserve(size_t count);
+
+        // Appends an entity, its components are left uninitialised and must be constructed by the caller
+        row_t pushEntity(uint32_t entity);
+
+        // Removes a row whose components have already been moved out or destroyed, filling the hole with the last row.
+        // Returns the entity that now lives in `row`, or the removed one if it was the last row.
+        uint32_t removeRow(row_t row);
+
+        // Destroys the components of a row and removes it
+        uint32_t destroyRow(row_t row);
+
+        static const ComponentInfo &getComponentInfo(ComponentType type);
+        static bool isRegistered(ComponentType type);
+    private:
+        ComponentType_t mask;
+        std::vector<uint32_t> entities;
+        std::array<Column, MAX_COMPONENT_TYPES> columns{};
+        size_t capacity = 0;
+    };
+}
+
+#endif
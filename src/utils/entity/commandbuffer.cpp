@@ -0,0 +1,152 @@
+#include "commandbuffer.hpp"
+
+#include <algorithm>
+
+namespace Engine {
+    EntityCommandBuffer::~EntityCommandBuffer() {
+        clear();
+        for (auto &block : blocks) ::operator delete(block.data, std::align_val_t{CACHE_LINE_SIZE});
+    }
+
+    EntityCommandBuffer::PendingEntity EntityCommandBuffer::createEntity() {
+        PendingEntity entity{pendingCount++};
+        record({entity.index, true, Op::CREATE});
+        return entity;
+    }
+
+    void EntityCommandBuffer::playback(Registry &registry) {
+        EntityCommandBuffer *self = this;
+        playback(registry, &self, 1);
+    }
+
+    void EntityCommandBuffer::clear() {
+        for (auto &command : commands)
+            if (command.op == Op::ADD) Archetype::getComponentInfo(command.type).destroy(command.component);
+        reset();
+    }
+
+    void EntityCommandBuffer::reset() {
+        commands.clear();
+        for (auto &block : blocks) block.used = 0;
+        currentBlock = 0;
+        pendingCount = 0;
+    }
+
+    void *EntityCommandBuffer::allocate(size_t size, size_t alignment) {
+        assert(alignment <= CACHE_LINE_SIZE && "Component alignment is too big!");
+
+        for (; currentBlock < blocks.size(); currentBlock++) {
+            Block &block = blocks[currentBlock];
+            const size_t offset = (block.used + alignment - 1) & ~(alignment - 1);
+            if (offset + size > block.size) continue;
+
+            block.used = offset + size;
+            return block.data + offset;
+        }
+
+        // Out of room, components bigger than a block get one of their own
+        const size_t blockSize = std::max(BLOCK_SIZE, size);
+        auto *data = static_cast<std::byte*>(::operator new(blockSize, std::align_val_t{CACHE_LINE_SIZE}));
+        blocks.push_back({data, blockSize, size});
+        currentBlock = blocks.size() - 1;
+        return data;
+    }
+
+    void EntityCommandBuffer::playback(Registry &registry, EntityCommandBuffer *const *buffers, size_t count) {
+        struct Entry {
+            uint64_t key; // Existing entities sort by id, pending ones come after them in creation order
+            uint32_t buffer;
+            uint32_t command;
+        };
+        constexpr uint64_t PENDING_BIT = 1ull << 32;
+
+        std::vector<Entry> entries;
+        std::vector<uint32_t> pendingBases(count);
+        size_t commandCount = 0;
+        uint32_t pendingCount = 0;
+        for (size_t b = 0; b < count; b++) {
+            pendingBases[b] = pendingCount;
+            pendingCount += buffers[b]->pendingCount;
+            commandCount += buffers[b]->commands.size();
+        }
+
+        entries.reserve(commandCount);
+        for (size_t b = 0; b < count; b++) {
+            const auto &commands = buffers[b]->commands;
+            for (size_t i = 0; i < commands.size(); i++) {
+                const uint64_t key = commands[i].pending ? PENDING_BIT | (pendingBases[b] + commands[i].target)
+                                                         : commands[i].target;
+                entries.push_back({key, static_cast<uint32_t>(b), static_cast<uint32_t>(i)});
+            }
+        }
+
+        // Stable, so the commands of an entity keep the order they were recorded in
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.key < b.key; });
+        registry.reserve(registry.size() + pendingCount);
+
+        for (size_t begin = 0, end = 0; begin < entries.size(); begin = end) {
+            const uint64_t key = entries[begin].key;
+
+            // Fold every change to this entity into a final set, so it moves archetype at most once
+            bool destroyed = false;
+            ComponentType_t removed = 0;
+            std::array<void*, MAX_COMPONENT_TYPES> sources{};
+            for (end = begin; end < entries.size() && entries[end].key == key; end++) {
+                const Command &command = buffers[entries[end].buffer]->commands[entries[end].command];
+                const auto bit = static_cast<ComponentType_t>(1 << command.type);
+                void *&source = sources[command.type];
+
+                switch (command.op) {
+                    case Op::CREATE:
+                        break;
+                    case Op::DESTROY:
+                        destroyed = true;
+                        break;
+                    case Op::ADD:
+                        if (source) Archetype::getComponentInfo(command.type).destroy(source); // Last one wins
+                        source = command.component;
+                        removed &= static_cast<ComponentType_t>(~bit);
+                        break;
+                    case Op::REMOVE:
+                        if (source) Archetype::getComponentInfo(command.type).destroy(source);
+                        source = nullptr;
+                        removed |= bit;
+                        break;
+                }
+            }
+
+            const bool pending = key & PENDING_BIT;
+            auto id = static_cast<Entity::id_t>(key);
+            if (destroyed || (!pending && !registry.isAlive(id))) {
+                // Destroyed, or it was already gone when the buffer got played back, nothing recorded for it is kept
+                for (size_t type = 0; type < MAX_COMPONENT_TYPES; type++)
+                    if (sources[type]) Archetype::getComponentInfo(static_cast<ComponentType>(type)).destroy(sources[type]);
+                if (!pending && registry.isAlive(id)) registry.destroyEntity(id);
+                continue;
+            }
+
+            if (pending) id = registry.createEntity().getId();
+            registry.applyComponentChanges(id, removed, sources);
+        }
+
+        for (size_t b = 0; b < count; b++) buffers[b]->reset();
+    }
+
+    EntityCommandBuffer &EntityCommandBuffers::local() {
+        std::lock_guard<std::mutex> lock{mutex};
+        EntityCommandBuffer *&buffer = threadBuffers[std::this_thread::get_id()];
+        if (!buffer) {
+            buffers.push_back(std::make_unique<EntityCommandBuffer>());
+            buffer = buffers.back().get();
+        } return *buffer;
+    }
+
+    void EntityCommandBuffers::playback(Registry &registry) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        std::vector<EntityCommandBuffer*> pointers;
+        pointers.reserve(buffers.size());
+        for (auto &buffer : buffers) pointers.push_back(buffer.get());
+        EntityCommandBuffer::playback(registry, pointers.data(), pointers.size());
+    }
+}
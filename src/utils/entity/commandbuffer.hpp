@@ -0,0 +1,122 @@
+#ifndef ENTITY_COMMANDBUFFER_HPP
+#define ENTITY_COMMANDBUFFER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "entity.hpp"
+
+namespace Engine {
+    // Records structural changes (creating and destroying entities, adding and removing components) to apply them later,
+    // so systems can spawn and despawn while iterating, or from several threads at once.
+    // Components are constructed right away into the buffer's own memory and moved into the registry on playback.
+    // A buffer must only be used by one thread at a time, see EntityCommandBuffers for one per thread.
+    class EntityCommandBuffer {
+    public:
+        // Stand-in for an entity that will only exist once the buffer is played back
+        struct PendingEntity {
+            uint32_t index;
+        };
+
+        EntityCommandBuffer() = default;
+        ~EntityCommandBuffer();
+
+        EntityCommandBuffer(const EntityCommandBuffer &) = delete;
+        EntityCommandBuffer &operator=(const EntityCommandBuffer &) = delete;
+
+        PendingEntity createEntity();
+        void destroyEntity(Entity::id_t id) { record({id, false, Op::DESTROY}); }
+        void destroyEntity(PendingEntity entity) { record({entity.index, true, Op::DESTROY}); }
+
+        template<typename T, typename... Args>
+        void addComponent(Entity::id_t id, Args &&...args) {
+            record({id, false, Op::ADD, T::TYPE, construct<T>(std::forward<Args>(args)...)});
+        }
+        template<typename T, typename... Args>
+        void addComponent(PendingEntity entity, Args &&...args) {
+            record({entity.index, true, Op::ADD, T::TYPE, construct<T>(std::forward<Args>(args)...)});
+        }
+
+        template<typename T>
+        void removeComponent(Entity::id_t id) { record({id, false, Op::REMOVE, T::TYPE}); }
+        template<typename T>
+        void removeComponent(PendingEntity entity) { record({entity.index, true, Op::REMOVE, T::TYPE}); }
+
+        bool empty() const { return commands.empty(); }
+        size_t size() const { return commands.size(); }
+
+        // Applies everything and leaves the buffer empty. Must be called while no system is touching the registry.
+        void playback(Registry &registry);
+
+        // Drops every recorded command without applying it
+        void clear();
+
+        // Plays back several buffers in a single pass: commands are sorted by entity, so each entity goes through all of
+        // its changes with at most one archetype move, and buffers are applied in order for the same entity
+        static void playback(Registry &registry, EntityCommandBuffer *const *buffers, size_t count);
+    private:
+        enum class Op : uint8_t {
+            CREATE,
+            DESTROY,
+            ADD,
+            REMOVE,
+        };
+
+        struct Command {
+            uint32_t target; // An entity id, or the index of a pending entity
+            bool pending;
+            Op op;
+            ComponentType type = TRANSFORM;
+            void *component = nullptr; // Only for ADD, lives in the blocks below
+        };
+
+        // Components are bump allocated from fixed size blocks, so they never move once constructed
+        struct Block {
+            std::byte *data;
+            size_t size;
+            size_t used;
+        };
+
+        static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+        std::vector<Command> commands;
+        std::vector<Block> blocks;
+        size_t currentBlock = 0;
+        uint32_t pendingCount = 0;
+
+        void record(const Command &command) { commands.push_back(command); }
+        void *allocate(size_t size, size_t alignment);
+        void reset(); // Forgets the commands and rewinds the blocks, the components must already be gone
+
+        template<typename T, typename... Args>
+        void *construct(Args &&...args) {
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+    };
+
+    // One EntityCommandBuffer per thread, handed out on first use and played back together at a sync point
+    class EntityCommandBuffers {
+    public:
+        EntityCommandBuffers() = default;
+
+        EntityCommandBuffers(const EntityCommandBuffers &) = delete;
+        EntityCommandBuffers &operator=(const EntityCommandBuffers &) = delete;
+
+        // The buffer of the calling thread
+        EntityCommandBuffer &local();
+
+        void playback(Registry &registry);
+    private:
+        std::mutex mutex;
+        std::unordered_map<std::thread::id, EntityCommandBuffer*> threadBuffers;
+        std::vector<std::unique_ptr<EntityCommandBuffer>> buffers; // In creation order, so playback is deterministic
+    };
+}
+
+#endif
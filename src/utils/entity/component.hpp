@@ -2,8 +2,10 @@
 #define COMPONENT_HPP
 
 #include <cstdint>
+#include <cstddef>
 #include <memory>
-#include <map>
+#include <new>
+#include <utility>
 #include <cassert>
 
 namespace Engine {
@@ -13,19 +15,50 @@ namespace Engine {
         TRANSFORM = 0,
         MODEL = 1,
         POINT_LIGHT = 2,
+        HIERARCHY = 3,
     };
 
+    constexpr size_t MAX_COMPONENT_TYPES = 8 * sizeof(ComponentType_t);
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // Components are plain data, they don't carry a vtable, each one just declares its type through a static TYPE member.
+    // They are stored by value inside the archetype columns (see archetype.hpp), so they have to be movable.
     class Component {
     public:
         Component() = default;
-        virtual ~Component() = default;
+        ~Component() = default;
 
         Component(const Component &) = delete;
         Component &operator=(const Component &) = delete;
         Component(Component &&) = default;
         Component &operator=(Component &&) = default;
+    };
+
+    // Builds the component mask of a set of component types at compile time
+    template<typename... Ts>
+    constexpr ComponentType_t componentMask() {
+        return static_cast<ComponentType_t>((0 | ... | (1 << Ts::TYPE)));
+    }
+
+    // Type-erased operations needed to store a component inside an archetype column
+    struct ComponentInfo {
+        size_t size = 0;
+        size_t alignment = 0;
+
+        void (*moveConstruct)(void *dst, void *src) = nullptr; // Moves src into dst, and destroys src
+        void (*destroy)(void *ptr) = nullptr;
 
-        virtual ComponentType getComponentType() const = 0;
+        template<typename T>
+        static constexpr ComponentInfo of() {
+            static_assert(alignof(T) <= CACHE_LINE_SIZE, "Components cannot be over-aligned!");
+            return {sizeof(T),
+                    alignof(T),
+                    [](void *dst, void *src) {
+                        new (dst) T(std::move(*static_cast<T*>(src)));
+                        static_cast<T*>(src)->~T();
+                    },
+                    [](void *ptr) { static_cast<T*>(ptr)->~T(); }};
+        }
     };
 }
 
@@ -0,0 +1,78 @@
+#include "componentpool.hpp"
+#include "archetype.hpp"
+
+#include <bit>
+#include <stdexcept>
+
+namespace Engine {
+    ComponentPool::~ComponentPool() {
+        trim();
+    }
+
+    size_t ComponentPool::roundCapacity(size_t capacity) {
+        return std::bit_ceil(std::max(capacity, MIN_CAPACITY));
+    }
+
+    size_t ComponentPool::sizeClassOf(size_t capacity) {
+        assert(capacity >= MIN_CAPACITY && std::has_single_bit(capacity) && "Invalid block capacity!");
+        const auto sizeClass = static_cast<size_t>(std::countr_zero(capacity / MIN_CAPACITY));
+        if (sizeClass >= SIZE_CLASSES) throw std::runtime_error("Component block too big!");
+        return sizeClass;
+    }
+
+    std::byte *ComponentPool::acquire(size_t capacity) {
+        assert(isActive() && "Component pool has not been initialised!");
+        const size_t sizeClass = sizeClassOf(capacity);
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stats.usedCapacity += capacity;
+            stats.usedBlocks++;
+
+            auto &freeList = freeBlocks[sizeClass];
+            if (!freeList.empty()) {
+                std::byte *block = freeList.back();
+                freeList.pop_back();
+                stats.freeCapacity -= capacity;
+                stats.freeBlocks--;
+                stats.reuses++;
+                return block;
+            } stats.allocations++;
+        }
+
+        return static_cast<std::byte*>(::operator new(capacity * info->size, std::align_val_t{CACHE_LINE_SIZE}));
+    }
+
+    void ComponentPool::release(std::byte *block, size_t capacity) {
+        const size_t sizeClass = sizeClassOf(capacity);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        freeBlocks[sizeClass].push_back(block);
+        stats.usedCapacity -= capacity;
+        stats.usedBlocks--;
+        stats.freeCapacity += capacity;
+        stats.freeBlocks++;
+    }
+
+    void ComponentPool::trim() {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (auto &freeList : freeBlocks) {
+            for (std::byte *block : freeList) ::operator delete(block, std::align_val_t{CACHE_LINE_SIZE});
+            freeList.clear();
+        }
+
+        stats.freeCapacity = 0;
+        stats.freeBlocks = 0;
+    }
+
+    ComponentPool::Stats ComponentPool::getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return stats;
+    }
+
+    ComponentPools::ComponentPools() {
+        for (size_t type = 0; type < MAX_COMPONENT_TYPES; type++)
+            if (Archetype::isRegistered(static_cast<ComponentType>(type)))
+                pools[type].init(Archetype::getComponentInfo(static_cast<ComponentType>(type)));
+    }
+}
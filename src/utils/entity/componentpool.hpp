@@ -0,0 +1,78 @@
+#ifndef COMPONENTPOOL_HPP
+#define COMPONENTPOOL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <mutex>
+
+#include "component.hpp"
+
+namespace Engine {
+    // Storage for the columns of a single component type.
+    // Columns always hold a power of two number of components, so blocks are grouped in size classes, and a block given
+    // back when a column grows or an archetype goes away is kept in a free list to be handed out again, instead of going
+    // back to the global allocator. Spawning bursts of entities mostly end up recycling blocks.
+    class ComponentPool {
+    public:
+        static constexpr size_t MIN_CAPACITY = 64; // Components in the smallest block
+        static constexpr size_t SIZE_CLASSES = 24; // Up to MIN_CAPACITY << 23 components per block
+
+        struct Stats {
+            size_t liveComponents = 0; // Filled in by Registry::getComponentStats, the pool only knows about blocks
+            size_t usedCapacity = 0; // Components worth of storage handed out to columns
+            size_t freeCapacity = 0; // Components worth of storage sitting in the free lists
+            size_t usedBlocks = 0;
+            size_t freeBlocks = 0;
+            size_t allocations = 0; // Blocks that had to come from the global allocator
+            size_t reuses = 0; // Blocks that came from a free list
+
+            size_t reservedBytes(size_t componentSize) const { return (usedCapacity + freeCapacity) * componentSize; }
+            // Fraction of the storage handed out to columns that actually holds a component
+            float occupancy() const {
+                return usedCapacity == 0 ? 0.0f : static_cast<float>(liveComponents) / static_cast<float>(usedCapacity);
+            }
+        };
+
+        ComponentPool() = default;
+        ~ComponentPool();
+
+        ComponentPool(const ComponentPool &) = delete;
+        ComponentPool &operator=(const ComponentPool &) = delete;
+
+        void init(const ComponentInfo &componentInfo) { info = &componentInfo; }
+        bool isActive() const { return info != nullptr; }
+
+        // Returns uninitialised storage for `capacity` components, aligned to a cache line. Capacity must be a power of
+        // two of at least MIN_CAPACITY (see roundCapacity)
+        std::byte *acquire(size_t capacity);
+        void release(std::byte *block, size_t capacity);
+
+        // Gives every block in the free lists back to the global allocator
+        void trim();
+
+        Stats getStats() const;
+
+        static size_t roundCapacity(size_t capacity);
+    private:
+        const ComponentInfo *info = nullptr;
+        std::array<std::vector<std::byte*>, SIZE_CLASSES> freeBlocks{};
+        Stats stats{};
+        mutable std::mutex mutex;
+
+        static size_t sizeClassOf(size_t capacity);
+    };
+
+    // One pool per component type, owned by the registry
+    struct ComponentPools {
+        std::array<ComponentPool, MAX_COMPONENT_TYPES> pools{};
+
+        ComponentPools();
+
+        ComponentPool &operator[](ComponentType type) { return pools[type]; }
+        const ComponentPool &operator[](ComponentType type) const { return pools[type]; }
+    };
+}
+
+#endif
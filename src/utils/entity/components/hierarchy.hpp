@@ -0,0 +1,21 @@
+#ifndef HIERARCHY_COMPONENT_HPP
+#define HIERARCHY_COMPONENT_HPP
+
+#include "../component.hpp"
+
+namespace Engine {
+    // Attaches an entity to a parent, its transform becomes relative to the parent's one.
+    // To re-parent an entity, remove the component and add a new one, so the hierarchy gets rebuilt.
+    class HierarchyComponent : public Component {
+    public:
+        static constexpr ComponentType TYPE = HIERARCHY;
+
+        explicit HierarchyComponent(uint32_t parent) : parent(parent) {}
+
+        uint32_t getParent() const { return parent; }
+    private:
+        uint32_t parent; // Entity::id_t of the parent
+    };
+}
+
+#endif
@@ -6,11 +6,14 @@
 namespace Engine {
     class ModelComponent : public Component {
     public:
-        std::shared_ptr<Model> model;
+        static constexpr ComponentType TYPE = MODEL;
 
-        ModelComponent(std::shared_ptr<Model> model) : model(model) {}
+        std::shared_ptr<Model> model;
+        uint32_t textureIndex; // Slot in the TextureTable, 0 is the first texture registered
+        bool visible = true; // Whether it's inside the camera frustum, set by the CullingSystem
 
-        ComponentType getComponentType() const override { return MODEL; }
+        ModelComponent(std::shared_ptr<Model> model, uint32_t textureIndex = 0) :
+            model(std::move(model)), textureIndex(textureIndex) {}
     };
 }
 
@@ -1,15 +1,32 @@
 #ifndef POINT_LIGHT_COMPONENT_HPP
 #define POINT_LIGHT_COMPONENT_HPP
 
+#include <glm/glm.hpp>
+
+#include <cmath>
+
 #include "../component.hpp"
 
 namespace Engine {
     class PointLightComponent : public Component {
     public:
+        static constexpr ComponentType TYPE = POINT_LIGHT;
+
+        // Below this, a light's contribution is dropped, it's what the default radius is derived from
+        static constexpr float CUTOFF_INTENSITY = 0.01f;
+
         float intensity;
+        glm::vec3 color{1.0f, 1.0f, 1.0f};
+        float radius; // Range of the light, it fades out to nothing there (see LightClusterSystem)
+
+        PointLightComponent(float intensity) : intensity(intensity), radius(defaultRadius(intensity)) {}
+        PointLightComponent(float intensity, glm::vec3 color) :
+            intensity(intensity), color(color), radius(defaultRadius(intensity)) {}
+        PointLightComponent(float intensity, glm::vec3 color, float radius) :
+            intensity(intensity), color(color), radius(radius) {}
 
-        PointLightComponent(float intensity) : intensity(intensity) {}
-        ComponentType getComponentType() const override { return POINT_LIGHT; }
+        // Distance at which the inverse square falloff drops below CUTOFF_INTENSITY
+        static float defaultRadius(float intensity) { return std::sqrt(intensity / CUTOFF_INTENSITY); }
     };
 }
 
@@ -2,42 +2,139 @@
 #define TRANSFORM_COMPONENT_HPP
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
 
 #include "../component.hpp"
 
 namespace Engine {
+    // Besides its current state, a transform keeps the one it had at the start of the simulation step, so the renderer
+    // can interpolate between both when frames fall between two fixed steps (see FixedTimestep).
     class TransformComponent : public Component {
     public:
-        glm::vec3 position{0.0f, 0.0f, 0.0f};
-        glm::vec3 scale{1.0f, 1.0f, 1.0f};
-        glm::vec3 rotation{0.0f, 0.0f, 0.0f};
+        static constexpr ComponentType TYPE = TRANSFORM;
+
+        // Position, scale and rotation at a given instant
+        struct Pose {
+            glm::vec3 position;
+            glm::vec3 scale;
+            glm::vec3 rotation;
+        };
 
         TransformComponent() = default;
         TransformComponent(const glm::vec3 position) :
-                           position(position) {}
+                           position(position), previousPosition(position) {}
         TransformComponent(const glm::vec3 position, const glm::vec3 scale) :
-                           position(position), scale(scale) {}
+                           position(position), scale(scale), previousPosition(position), previousScale(scale) {}
         TransformComponent(const glm::vec3 position, const glm::vec3 scale, const glm::vec3 rotation) :
-                           position(position), scale(scale), rotation(rotation) {}
+                           position(position), scale(scale), rotation(rotation),
+                           previousPosition(position), previousScale(scale), previousRotation(rotation) {}
+
+        const glm::vec3 &getPosition() const { return position; }
+        const glm::vec3 &getScale() const { return scale; }
+        const glm::vec3 &getRotation() const { return rotation; }
+
+        // Every write marks the cached matrices as dirty, so they only get rebuilt when something actually moved
+        void setPosition(const glm::vec3 &newPosition) { position = newPosition; dirty = moving = true; }
+        void setScale(const glm::vec3 &newScale) { scale = newScale; dirty = moving = true; }
+        void setRotation(const glm::vec3 &newRotation) { rotation = newRotation; dirty = moving = true; }
+
+        bool isDirty() const { return dirty; }
+        // Whether the cached matrices have to be rebuilt, moving transforms need it every frame as the blend changes
+        bool needsUpdate() const { return dirty || moving; }
+
+        // Called at the start of every simulation step, the current state becomes the one to interpolate from
+        void beginStep() {
+            if (!moving) return;
+            previousPosition = position;
+            previousScale = scale;
+            previousRotation = rotation;
+            moving = false;
+            dirty = true; // Rendered pose goes from a blend to the current state
+        }
+
+        // Skips the interpolation up to the current state, for teleports and such
+        void resetInterpolation() {
+            moving = true;
+            beginStep();
+        }
 
-        ComponentType getComponentType() const override { return TRANSFORM; }
+        // Blend between the state at the start of the step (alpha = 0) and the current one (alpha = 1).
+        // Rotations take the shortest way around, so angles wrapping at 2 pi don't spin all the way back.
+        Pose interpolate(float alpha) const {
+            if (!moving) return {position, scale, rotation};
+
+            const glm::vec3 rotationDelta = glm::mod(rotation - previousRotation + glm::pi<float>(), glm::two_pi<float>())
+                                          - glm::pi<float>();
+            return {glm::mix(previousPosition, position, alpha),
+                    glm::mix(previousScale, scale, alpha),
+                    previousRotation + rotationDelta * alpha};
+        }
+
+        // Bumped every time the cached matrices are rebuilt, children use it to know when their parent moved
+        uint32_t getVersion() const { return version; }
+
+        // Rebuilds the cached matrices from the interpolated pose if needed, returns whether it did
+        bool updateMatrices(float alpha = 1.0f) {
+            if (!needsUpdate()) return false;
+            const Pose pose = interpolate(alpha);
+            modelMatrix = computeMat4(pose);
+            normalMatrix = computeNormal(pose);
+            dirty = false;
+            version++;
+            return true;
+        }
+
+        // Stores matrices built elsewhere from this transform, used by the batched kernel (see TransformKernel)
+        void setMatrices(const glm::mat4 &model, const glm::mat3 &normal) {
+            modelMatrix = model;
+            normalMatrix = normal;
+            dirty = false;
+            version++;
+        }
+
+        // Same as above, but for an entity attached to a parent: the cached matrices end up in world space
+        // The normal matrix of a product is the product of the normal matrices, so they compose the same way
+        void updateMatrices(const TransformComponent &parent, float alpha = 1.0f) {
+            const Pose pose = interpolate(alpha);
+            modelMatrix = parent.modelMatrix * computeMat4(pose);
+            normalMatrix = parent.normalMatrix * computeNormal(pose);
+            dirty = false;
+            version++;
+        }
+
+        // Cached world space matrices, only valid after updateMatrices() (see TransformSystem::update)
+        const glm::mat4 &mat4() const {
+            assert(!dirty && "Transform matrices are out of date!");
+            return modelMatrix;
+        }
+        const glm::mat3 &normal() const {
+            assert(!dirty && "Transform matrices are out of date!");
+            return normalMatrix;
+        }
+
+        // Matrices of the current state
+        glm::mat4 computeMat4() const { return computeMat4({position, scale, rotation}); }
+        glm::mat3 computeNormal() const { return computeNormal({position, scale, rotation}); }
 
         // Matrix corresponds to Translate * Rx * Ry * Rz * Scale
         // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
         // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
-        glm::mat4 mat4() const {
+        static glm::mat4 computeMat4(const Pose &pose) {
             glm::mat4 mat{1.0f};
-            mat = glm::translate(mat, position);
-            mat = glm::rotate(mat, rotation.x, {1.0f, 0.0f, 0.0f});
-            mat = glm::rotate(mat, rotation.y, {0.0f, 1.0f, 0.0f});
-            mat = glm::rotate(mat, rotation.z, {0.0f, 0.0f, 1.0f});
-            mat = glm::scale(mat, scale);
+            mat = glm::translate(mat, pose.position);
+            mat = glm::rotate(mat, pose.rotation.x, {1.0f, 0.0f, 0.0f});
+            mat = glm::rotate(mat, pose.rotation.y, {0.0f, 1.0f, 0.0f});
+            mat = glm::rotate(mat, pose.rotation.z, {0.0f, 0.0f, 1.0f});
+            mat = glm::scale(mat, pose.scale);
             return mat;
         }
 
         // The normal matrix is the inverse transpose of the model matrix
         // This can also be defined as R * S^-1
-        glm::mat3 normal() const {
+        static glm::mat3 computeNormal(const Pose &pose) {
+                const glm::vec3 &rotation = pose.rotation;
+                const glm::vec3 &scale = pose.scale;
+
                 const float s1 = glm::sin(rotation.x);
                 const float c1 = glm::cos(rotation.x);
 
@@ -76,6 +173,20 @@ namespace Engine {
                                 zc2 * c1,
                     }};
         }
+    private:
+        glm::vec3 position{0.0f, 0.0f, 0.0f};
+        glm::vec3 scale{1.0f, 1.0f, 1.0f};
+        glm::vec3 rotation{0.0f, 0.0f, 0.0f};
+
+        glm::vec3 previousPosition{0.0f, 0.0f, 0.0f};
+        glm::vec3 previousScale{1.0f, 1.0f, 1.0f};
+        glm::vec3 previousRotation{0.0f, 0.0f, 0.0f};
+
+        glm::mat4 modelMatrix{1.0f};
+        glm::mat3 normalMatrix{1.0f};
+        uint32_t version = 0;
+        bool dirty = true;
+        bool moving = false; // The current state differs from the previous one
     };
 }
 
@@ -1,16 +1,161 @@
 #include "entity.hpp"
 
 namespace Engine {
-    Entity Entity::createEntity() {
-        static id_t currentId = 0;
-        return {currentId++};
-    }
-    Entity Entity::createPointLightEntity(float intensity, float radius, glm::vec3 color) {
-        Entity ent = Entity::createEntity();
-        ent.color = color;
-        ent.addComponent(std::make_unique<TransformComponent>(glm::vec3(0.0f),
-                                                              glm::vec3{radius, 1.0f, 1.0f}));
-        ent.addComponent(std::make_unique<PointLightComponent>(intensity));
+    Registry::Registry() {
+        getOrCreateArchetype(0); // Entities without components live here
+    }
+
+    void Registry::reserve(size_t count) {
+        records.reserve(count);
+        dense.reserve(count);
+    }
+
+    Entity Registry::createEntity() {
+        return {allocateEntity(*archetypeIndex[0]).first, this};
+    }
+
+    std::pair<Archetype*, Archetype::row_t> Registry::allocateEntities(ComponentType_t mask,
+                                                                      size_t count,
+                                                                      Entity::id_t *ids) {
+        Archetype &archetype = getOrCreateArchetype(mask);
+        archetype.reserve(archetype.size() + count);
+        grow(records, count - std::min(count, freeIndices.size()));
+        grow(dense, count);
+
+        const auto firstRow = static_cast<Archetype::row_t>(archetype.size());
+        for (size_t i = 0; i < count; i++) {
+            Entity::id_t id = allocateEntity(archetype).first;
+            if (ids) ids[i] = id;
+        }
+
+        structureVersion++;
+        return {&archetype, firstRow};
+    }
+
+    std::pair<Entity::id_t, Archetype::row_t> Registry::allocateEntity(Archetype &archetype) {
+        uint32_t index;
+        if (!freeIndices.empty()) {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        } else {
+            assert(records.size() <= Entity::INDEX_MASK && "Ran out of entity indices!");
+            index = static_cast<uint32_t>(records.size());
+            records.emplace_back();
+        }
+
+        EntityRecord &record = records[index];
+        Entity::id_t id = Entity::makeId(index, record.version);
+
+        record.archetype = &archetype;
+        record.row = archetype.pushEntity(id);
+        record.denseIndex = static_cast<uint32_t>(dense.size());
+        dense.push_back(id);
+        return {id, record.row};
+    }
+    Entity Registry::createPointLightEntity(float intensity, float radius, glm::vec3 color) {
+        Entity ent = createEntity();
+        ent.addComponent<TransformComponent>(glm::vec3(0.0f), glm::vec3{radius, 1.0f, 1.0f});
+        ent.addComponent<PointLightComponent>(intensity, color);
         return ent;
     }
-}
\ No newline at end of file
+
+    void Registry::destroyEntity(Entity::id_t id) {
+        EntityRecord &record = getRecord(id);
+
+        Entity::id_t moved = record.archetype->destroyRow(record.row);
+        if (moved != id) records[Entity::indexOf(moved)].row = record.row;
+
+        // Swap-remove from the dense array
+        Entity::id_t last = dense.back();
+        dense[record.denseIndex] = last;
+        records[Entity::indexOf(last)].denseIndex = record.denseIndex;
+        dense.pop_back();
+
+        // Bumping the version invalidates every handle still pointing to this index
+        record.archetype = nullptr;
+        record.version = (record.version + 1) & Entity::VERSION_MASK;
+        freeIndices.push_back(Entity::indexOf(id));
+        structureVersion++;
+    }
+
+    void Registry::applyComponentChanges(Entity::id_t id,
+                                         ComponentType_t removed,
+                                         const std::array<void*, MAX_COMPONENT_TYPES> &sources) {
+        ComponentType_t added = 0;
+        for (size_t type = 0; type < MAX_COMPONENT_TYPES; type++)
+            if (sources[type]) added |= static_cast<ComponentType_t>(1 << type);
+
+        const ComponentType_t current = getComponentMask(id);
+        const auto newMask = static_cast<ComponentType_t>((current & ~removed) | added);
+
+        Archetype::row_t row = getRecord(id).row;
+        if (newMask != current) row = moveEntity(id, newMask);
+
+        Archetype &archetype = *getRecord(id).archetype;
+        for (size_t i = 0; i < MAX_COMPONENT_TYPES; i++) {
+            if (!sources[i]) continue;
+
+            auto type = static_cast<ComponentType>(i);
+            const ComponentInfo &info = Archetype::getComponentInfo(type);
+            void *destination = archetype.getComponent(type, row);
+            if (current & (1 << type)) info.destroy(destination); // Moved along by moveEntity, replace it
+            info.moveConstruct(destination, sources[i]);
+        }
+    }
+
+    Archetype &Registry::getOrCreateArchetype(ComponentType_t mask) {
+        if (archetypeIndex[mask] == nullptr) {
+            archetypes.push_back(std::make_unique<Archetype>(mask, pools));
+            Archetype *archetype = archetypes.back().get();
+            archetypeIndex[mask] = archetype;
+
+            // Keep the cached queries up to date, new archetypes are rare so this is cheap
+            for (auto &query : queries)
+                if (query && query->matches(*archetype)) query->archetypes.push_back(archetype);
+        } return *archetypeIndex[mask];
+    }
+
+    ComponentPool::Stats Registry::getComponentStats(ComponentType type) const {
+        ComponentPool::Stats stats = pools[type].getStats();
+        for (const auto &archetype : archetypes)
+            if (archetype->hasComponent(type)) stats.liveComponents += archetype->size();
+        return stats;
+    }
+
+    void Registry::trimComponentPools() {
+        for (auto &pool : pools.pools) pool.trim();
+    }
+
+    const Query &Registry::getOrCreateQuery(ComponentType_t mask) {
+        if (queries[mask] == nullptr) {
+            queries[mask] = std::make_unique<Query>();
+            queries[mask]->mask = mask;
+            for (auto &archetype : archetypes)
+                if (queries[mask]->matches(*archetype)) queries[mask]->archetypes.push_back(archetype.get());
+        } return *queries[mask];
+    }
+
+    Archetype::row_t Registry::moveEntity(Entity::id_t id, ComponentType_t newMask) {
+        EntityRecord &record = getRecord(id);
+        Archetype &src = *record.archetype;
+        Archetype &dst = getOrCreateArchetype(newMask);
+
+        Archetype::row_t row = dst.pushEntity(id);
+        for (size_t i = 0; i < MAX_COMPONENT_TYPES; i++) {
+            auto type = static_cast<ComponentType>(i);
+            if (!src.hasComponent(type)) continue;
+
+            const ComponentInfo &info = Archetype::getComponentInfo(type);
+            if (dst.hasComponent(type)) info.moveConstruct(dst.getComponent(type, row), src.getComponent(type, record.row));
+            else info.destroy(src.getComponent(type, record.row));
+        }
+
+        Entity::id_t moved = src.removeRow(record.row);
+        if (moved != id) records[Entity::indexOf(moved)].row = record.row;
+
+        record.archetype = &dst;
+        record.row = row;
+        structureVersion++;
+        return row;
+    }
+}
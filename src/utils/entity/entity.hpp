@@ -4,7 +4,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <memory>
-#include <unordered_map>
+#include <utility>
+#include <limits>
 
 #include "../model/model.hpp"
 
@@ -12,61 +13,55 @@
 #include "components/transform.hpp"
 #include "components/point_light.hpp"
 #include "components/model.hpp"
+#include "components/hierarchy.hpp"
 
 namespace Engine {
+    class Registry;
+
+    // An entity is just a handle into the registry that owns its components, so it's cheap to copy around.
     class Entity {
     public:
-        typedef uint16_t id_t; // 65536 entities should do, at least for now
-        typedef std::unordered_map<id_t, Entity> Map;
-
-        glm::vec3 color{};
-
-        Entity(const Entity &) = delete;
-        Entity &operator=(const Entity &) = delete;
-        Entity(Entity &&) = default;
-        Entity &operator=(Entity &&) = default;
-
-        ComponentType_t getComponentMask() const { return componentMask; }
-        bool hasComponent(ComponentType type) const { return componentMask & (1 << type); }
-
-        void addComponent(std::unique_ptr<Component> component) {
-            ComponentType type = component->getComponentType();
-            assert(!hasComponent(type) && "Component already exists for this entity!");
-            components[type] = std::move(component);
-            componentMask |= static_cast<ComponentType_t>(1 << type);
-        }
-        void removeComponent(ComponentType type) {
-            assert(hasComponent(type) && "Component does not exist for this entity!");
-            components.erase(type);
-            componentMask &= static_cast<ComponentType_t>(~(1 << type));
+        // Ids are generational: the low bits index into the registry, the high bits hold a version that gets bumped
+        // every time that index is recycled, so stale handles to destroyed entities can be told apart from live ones.
+        typedef uint32_t id_t;
+
+        static constexpr uint32_t INDEX_BITS = 22; // ~4 million entities alive at once
+        static constexpr uint32_t VERSION_BITS = 32 - INDEX_BITS;
+        static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static constexpr uint32_t VERSION_MASK = (1u << VERSION_BITS) - 1;
+        static constexpr id_t NULL_ID = std::numeric_limits<id_t>::max();
+
+        static constexpr uint32_t indexOf(id_t id) { return id & INDEX_MASK; }
+        static constexpr uint32_t versionOf(id_t id) { return id >> INDEX_BITS; }
+        static constexpr id_t makeId(uint32_t index, uint32_t version) {
+            return ((version & VERSION_MASK) << INDEX_BITS) | (index & INDEX_MASK);
         }
 
-        TransformComponent *getTransformComponent() {
-            assert(hasComponent(ComponentType::TRANSFORM) && "Transform component does not exist for this entity!");
-            return dynamic_cast<TransformComponent*>(components[ComponentType::TRANSFORM].get());
-        }
+        Entity() = default;
+        Entity(id_t id, Registry *registry) : id(id), registry(registry) {}
 
-        PointLightComponent *getPointLightComponent() {
-            assert(hasComponent(ComponentType::POINT_LIGHT) && "Point light component does not exist for this entity!");
-            return dynamic_cast<PointLightComponent*>(components[ComponentType::POINT_LIGHT].get());
-        }
+        ComponentType_t getComponentMask() const;
+        bool hasComponent(ComponentType type) const { return getComponentMask() & (1 << type); }
 
-        ModelComponent *getModelComponent() {
-            assert(hasComponent(ComponentType::MODEL) && "Model component does not exist for this entity!");
-            return dynamic_cast<ModelComponent*>(components[ComponentType::MODEL].get());
-        }
+        template<typename T, typename... Args>
+        T &addComponent(Args &&...args);
+        template<typename T>
+        void removeComponent();
+        template<typename T>
+        T &getComponent();
 
-        static Entity createEntity();
-        static Entity createPointLightEntity(float intensity = 1.0f, float radius = 0.1f, glm::vec3 color = {1.0f, 1.0f, 1.0f});
+        TransformComponent *getTransformComponent();
+        PointLightComponent *getPointLightComponent();
+        ModelComponent *getModelComponent();
 
         id_t getId() const { return id; }
+        bool isValid() const;
     private:
-        id_t id;
-        ComponentType_t componentMask = 0;
-        std::map<ComponentType, std::unique_ptr<Component>> components;
-
-        Entity(id_t id) : id(id) {}
+        id_t id = NULL_ID;
+        Registry *registry = nullptr;
     };
 }
 
-#endif
\ No newline at end of file
+#include "registry.hpp"
+
+#endif
@@ -0,0 +1,32 @@
+#include "prefab.hpp"
+
+#include <chrono>
+
+namespace Engine {
+    Prefab::SpawnStats Prefab::spawn(Registry &registry,
+                                     std::span<const Instance> instances,
+                                     std::vector<Entity::id_t> *ids) const {
+        auto start = std::chrono::steady_clock::now();
+
+        Entity::id_t *idsOut = nullptr;
+        if (ids) {
+            ids->resize(ids->size() + instances.size());
+            idsOut = ids->data() + ids->size() - instances.size();
+        }
+
+        registry.createEntities<TransformComponent, ModelComponent>(
+            instances.size(),
+            [&](size_t i, TransformComponent *transform, ModelComponent *modelComponent) {
+                const Instance &instance = instances[i];
+                new (transform) TransformComponent(instance.position, instance.scale, instance.rotation);
+                new (modelComponent) ModelComponent(model, textureIndex);
+            },
+            idsOut);
+
+        SpawnStats stats{};
+        stats.entityCount = instances.size();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats.entitiesPerSecond = stats.seconds > 0.0 ? static_cast<double>(stats.entityCount) / stats.seconds : 0.0;
+        return stats;
+    }
+}
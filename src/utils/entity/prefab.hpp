@@ -0,0 +1,45 @@
+#ifndef PREFAB_HPP
+#define PREFAB_HPP
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "entity.hpp"
+
+namespace Engine {
+    // Template to stamp out many entities sharing the same model in one go, e.g. Prefab{rockModel}.spawn(registry, rocks)
+    class Prefab {
+    public:
+        // Initial transform of one spawned entity
+        struct Instance {
+            glm::vec3 position{0.0f, 0.0f, 0.0f};
+            glm::vec3 scale{1.0f, 1.0f, 1.0f};
+            glm::vec3 rotation{0.0f, 0.0f, 0.0f};
+        };
+
+        struct SpawnStats {
+            size_t entityCount = 0;
+            double seconds = 0.0;
+            double entitiesPerSecond = 0.0;
+        };
+
+        explicit Prefab(std::shared_ptr<Model> model, uint32_t textureIndex = 0) :
+            model(std::move(model)), textureIndex(textureIndex) {}
+
+        // Creates one entity with a TransformComponent and a ModelComponent per instance, appending their ids to `ids`
+        // if given. Storage for all of them is reserved once, and they're built in place inside their final archetype.
+        SpawnStats spawn(Registry &registry,
+                         std::span<const Instance> instances,
+                         std::vector<Entity::id_t> *ids = nullptr) const;
+
+        const std::shared_ptr<Model> &getModel() const { return model; }
+        uint32_t getTextureIndex() const { return textureIndex; }
+    private:
+        std::shared_ptr<Model> model;
+        uint32_t textureIndex; // See TextureTable
+    };
+}
+
+#endif
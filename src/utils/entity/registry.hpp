@@ -0,0 +1,171 @@
+#ifndef REGISTRY_HPP
+#define REGISTRY_HPP
+
+#include <memory>
+#include <vector>
+#include <array>
+#include <limits>
+#include <cassert>
+#include <utility>
+#include <algorithm>
+
+#include "archetype.hpp"
+#include "view.hpp"
+#include "entity.hpp"
+
+namespace Engine {
+    // Owns every entity and component of a scene.
+    // Components are stored in archetypes (see archetype.hpp), entities with the same component mask share one, so
+    // systems can iterate over tightly packed component arrays instead of chasing pointers.
+    // Entities themselves live in a sparse set: a sparse array of records indexed by the id's index, a dense array
+    // with every alive id, and a free list of indices to recycle, so creating and destroying entities is O(1).
+    class Registry {
+    public:
+        Registry();
+        ~Registry() = default;
+
+        Registry(const Registry &) = delete;
+        Registry &operator=(const Registry &) = delete;
+
+        Entity createEntity();
+        Entity createPointLightEntity(float intensity = 1.0f,
+                                      float radius = 0.1f,
+                                      glm::vec3 color = {1.0f, 1.0f, 1.0f});
+        void destroyEntity(Entity::id_t id);
+
+        // Creates `count` entities straight into the archetype of Ts..., with storage for all of them reserved up front,
+        // so they never go through the empty archetype or move around while being built.
+        // construct(i, Ts*...) must placement-new every component of the i-th entity. Ids are written to `ids` if given.
+        template<typename... Ts, typename Construct>
+        void createEntities(size_t count, Construct &&construct, Entity::id_t *ids = nullptr) {
+            auto [archetype, firstRow] = allocateEntities(componentMask<Ts...>(), count, ids);
+            auto constructAll = [&](Ts *...columns) {
+                for (size_t i = 0; i < count; i++) construct(i, columns + firstRow + i...);
+            };
+            constructAll(archetype->template column<Ts>()...);
+        }
+
+        // Type-erased version of the above: appends `count` entities to the archetype of `mask` and returns it, along
+        // with the row of the first one. Their components are left uninitialised, every one of them must be constructed
+        // before anything else touches the registry.
+        std::pair<Archetype*, Archetype::row_t> allocateEntities(ComponentType_t mask, size_t count, Entity::id_t *ids);
+
+        void reserve(size_t count);
+
+        Entity getEntity(Entity::id_t id) { return {id, this}; }
+        size_t size() const { return dense.size(); }
+        const std::vector<Entity::id_t> &getEntities() const { return dense; }
+
+        // Bumped every time an entity changes archetype or gets destroyed, so caches built on top of the registry
+        // know when to rebuild
+        uint64_t getStructureVersion() const { return structureVersion; }
+
+        ComponentType_t getComponentMask(Entity::id_t id) const { return getRecord(id).archetype->getMask(); }
+        bool isAlive(Entity::id_t id) const {
+            const uint32_t index = Entity::indexOf(id);
+            return index < records.size() &&
+                   records[index].archetype != nullptr &&
+                   records[index].version == Entity::versionOf(id);
+        }
+
+        template<typename T, typename... Args>
+        T &addComponent(Entity::id_t id, Args &&...args) {
+            assert(!(getComponentMask(id) & (1 << T::TYPE)) && "Component already exists for this entity!");
+            Archetype::row_t row = moveEntity(id, getComponentMask(id) | componentMask<T>());
+            return *new (getRecord(id).archetype->getComponent(T::TYPE, row)) T(std::forward<Args>(args)...);
+        }
+
+        template<typename T>
+        void removeComponent(Entity::id_t id) {
+            assert((getComponentMask(id) & (1 << T::TYPE)) && "Component does not exist for this entity!");
+            moveEntity(id, static_cast<ComponentType_t>(getComponentMask(id) & ~componentMask<T>()));
+        }
+
+        // Applies several component changes with a single archetype move: drops the `removed` components, then moves
+        // every non-null sources[type] into the entity, replacing the component it already had of that type.
+        // The sources are left destroyed. Used to play back EntityCommandBuffers.
+        void applyComponentChanges(Entity::id_t id,
+                                   ComponentType_t removed,
+                                   const std::array<void*, MAX_COMPONENT_TYPES> &sources);
+
+        template<typename T>
+        T &getComponent(Entity::id_t id) {
+            assert((getComponentMask(id) & (1 << T::TYPE)) && "Component does not exist for this entity!");
+            const EntityRecord &record = getRecord(id);
+            return *static_cast<T*>(record.archetype->getComponent(T::TYPE, record.row));
+        }
+
+        // Returns a view over every entity that has, at least, all the given components.
+        // The matching archetypes are cached per mask and updated as new ones appear, so this is just a lookup.
+        template<typename... Ts>
+        View<Ts...> view() { return View<Ts...>{getOrCreateQuery(componentMask<Ts...>())}; }
+
+        // Storage statistics of a component type, including how much of it actually holds live components
+        ComponentPool::Stats getComponentStats(ComponentType type) const;
+
+        // Gives the storage cached by the component pools back to the global allocator
+        void trimComponentPools();
+
+        // Shorthand for view<Ts...>().each(func)
+        template<typename... Ts, typename Func>
+        void each(Func &&func) { view<Ts...>().each(std::forward<Func>(func)); }
+    private:
+        struct EntityRecord {
+            Archetype *archetype = nullptr; // nullptr when the index is free
+            Archetype::row_t row = 0;
+            uint32_t version = 0;
+            uint32_t denseIndex = 0;
+        };
+
+        std::vector<EntityRecord> records; // Sparse, indexed by Entity::indexOf(id)
+        std::vector<Entity::id_t> dense; // Every alive entity, tightly packed
+        std::vector<uint32_t> freeIndices;
+        uint64_t structureVersion = 0;
+
+        ComponentPools pools; // Must outlive the archetypes
+        std::vector<std::unique_ptr<Archetype>> archetypes;
+        std::array<Archetype*, std::numeric_limits<ComponentType_t>::max() + 1> archetypeIndex{}; // Indexed by mask
+        std::array<std::unique_ptr<Query>, std::numeric_limits<ComponentType_t>::max() + 1> queries{}; // Indexed by mask
+
+        EntityRecord &getRecord(Entity::id_t id) {
+            assert(isAlive(id) && "Entity does not exist!");
+            return records[Entity::indexOf(id)];
+        }
+        const EntityRecord &getRecord(Entity::id_t id) const {
+            assert(isAlive(id) && "Entity does not exist!");
+            return records[Entity::indexOf(id)];
+        }
+
+        // Reserves room for `extra` more elements, at least doubling so repeated small batches stay amortised
+        template<typename V>
+        static void grow(V &vector, size_t extra) {
+            if (vector.size() + extra > vector.capacity())
+                vector.reserve(std::max(vector.size() + extra, vector.capacity() * 2));
+        }
+
+        // Takes a free index and appends the new entity to the archetype, its components are left for the caller
+        std::pair<Entity::id_t, Archetype::row_t> allocateEntity(Archetype &archetype);
+
+        Archetype &getOrCreateArchetype(ComponentType_t mask);
+        const Query &getOrCreateQuery(ComponentType_t mask);
+
+        // Moves an entity and the components it shares with the new mask to the matching archetype, destroying the ones
+        // that aren't part of it. Returns the new row of the entity.
+        Archetype::row_t moveEntity(Entity::id_t id, ComponentType_t newMask);
+    };
+
+    template<typename T, typename... Args>
+    T &Entity::addComponent(Args &&...args) { return registry->addComponent<T>(id, std::forward<Args>(args)...); }
+    template<typename T>
+    void Entity::removeComponent() { registry->removeComponent<T>(id); }
+    template<typename T>
+    T &Entity::getComponent() { return registry->getComponent<T>(id); }
+
+    inline bool Entity::isValid() const { return registry != nullptr && registry->isAlive(id); }
+    inline ComponentType_t Entity::getComponentMask() const { return registry->getComponentMask(id); }
+    inline TransformComponent *Entity::getTransformComponent() { return &getComponent<TransformComponent>(); }
+    inline PointLightComponent *Entity::getPointLightComponent() { return &getComponent<PointLightComponent>(); }
+    inline ModelComponent *Entity::getModelComponent() { return &getComponent<ModelComponent>(); }
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef VIEW_HPP
+#define VIEW_HPP
+
+#include <vector>
+#include <cstddef>
+
+#include "archetype.hpp"
+
+namespace Engine {
+    // The set of archetypes matching a component mask. The registry owns one per mask that has ever been asked for, and
+    // keeps it up to date as new archetypes get created, so a query never has to look at entities it doesn't care about.
+    struct Query {
+        ComponentType_t mask = 0;
+        std::vector<Archetype*> archetypes{};
+
+        bool matches(const Archetype &archetype) const { return (archetype.getMask() & mask) == mask; }
+    };
+
+    // Lightweight handle over a cached query, get one through Registry::view<Ts...>()
+    template<typename... Ts>
+    class View {
+    public:
+        explicit View(const Query &query) : query(&query) {}
+
+        // Total number of entities matching the view
+        size_t size() const {
+            size_t count = 0;
+            for (const Archetype *archetype : query->archetypes) count += archetype->size();
+            return count;
+        }
+        bool empty() const { return size() == 0; }
+
+        // Calls func(Ts&...) for every matching entity, walking each archetype linearly
+        template<typename Func>
+        void each(Func &&func) const {
+            for (Archetype *archetype : query->archetypes) {
+                if (archetype->empty()) continue;
+
+                const size_t count = archetype->size();
+                auto iterate = [&](Ts *...columns) {
+                    for (size_t row = 0; row < count; row++) func(columns[row]...);
+                };
+                iterate(archetype->template column<Ts>()...);
+            }
+        }
+
+        // Same as each, but also hands out the id of the entity: func(Entity::id_t, Ts&...)
+        template<typename Func>
+        void eachWithId(Func &&func) const {
+            for (Archetype *archetype : query->archetypes) {
+                if (archetype->empty()) continue;
+
+                const size_t count = archetype->size();
+                const uint32_t *ids = archetype->getEntities().data();
+                auto iterate = [&](Ts *...columns) {
+                    for (size_t row = 0; row < count; row++) func(ids[row], columns[row]...);
+                };
+                iterate(archetype->template column<Ts>()...);
+            }
+        }
+
+        // Calls func(Archetype&) for every non-empty matching archetype, for systems that want to work on whole columns
+        template<typename Func>
+        void eachArchetype(Func &&func) const {
+            for (Archetype *archetype : query->archetypes)
+                if (!archetype->empty()) func(*archetype);
+        }
+    private:
+        const Query *query;
+    };
+}
+
+#endif
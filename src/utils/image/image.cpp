@@ -23,7 +23,7 @@ namespace Engine {
 
     Image::~Image() {
         vkDestroyImage(device.device(), image, nullptr);
-        vkFreeMemory(device.device(), imageMemory, nullptr);
+        device.getAllocator().free(imageMemory);
     }
 
     void Image::createImage () {
@@ -43,26 +43,10 @@ namespace Engine {
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.flags = 0; // Optional
 
-        if (vkCreateImage(device.device(), &imageInfo, nullptr, &image) != VK_SUCCESS)
-            throw std::runtime_error("Failed to create the texture image!");
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device.device(), image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = device.findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-            throw std::runtime_error("Failed to allocate the image memory!");
-
-        vkBindImageMemory(device.device(), image, imageMemory, 0);
+        device.createImageWithInfo(imageInfo, properties, image, imageMemory);
     }
 
-    void Image::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout) {
-        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
+    void Image::transitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) {
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = oldLayout;
@@ -99,15 +83,11 @@ namespace Engine {
                              0, nullptr,
                              0, nullptr,
                              1, &barrier);
-
-        device.endSingleTimeCommands(commandBuffer);
     }
 
-    void Image::copyBufferToImage(VkBuffer buffer) {
-        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
+    void Image::copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset) {
         VkBufferImageCopy region{};
-        region.bufferOffset = 0;
+        region.bufferOffset = bufferOffset;
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
 
@@ -129,21 +109,17 @@ namespace Engine {
                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                1,
                                &region);
-
-        device.endSingleTimeCommands(commandBuffer);
     }
 
     // Based on https://vulkan-tutorial.com/Generating_Mipmaps
     // TODO(Dory): Make this work with pre-generated textures.
-    void Image::generateMipmaps () {
+    void Image::generateMipmaps(VkCommandBuffer commandBuffer) {
         // Check if image format supports linear blitting
         VkFormatProperties formatProperties;
         formatProperties = device.getFormatProperties(format);
         if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
             throw std::runtime_error("Texture image format does not support linear blitting!");
 
-        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.image = image;
@@ -216,8 +192,6 @@ namespace Engine {
                              0, nullptr,
                              0, nullptr,
                              1, &barrier);
-
-        device.endSingleTimeCommands(commandBuffer);
     }
 
     VkImageView Image::createImageView() {
@@ -30,17 +30,21 @@ namespace Engine {
         Image(Image &&) = delete;
         Image& operator=(Image &&) = delete;
 
+        VkImage getImage() const { return image; }
         uint32_t getMipLevels() const { return mipLevels; }
+        uint32_t getMemoryType() const { return imageMemory.memoryType; }
+        VkDeviceSize getMemorySize() const { return imageMemory.size; }
 
-        void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
-        void copyBufferToImage(VkBuffer buffer);
-        void generateMipmaps();
+        // Recorded into commandBuffer, see UploadManager::uploadImage
+        void transitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
+        void copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset = 0);
+        void generateMipmaps(VkCommandBuffer commandBuffer);
         VkImageView createImageView();
     private:
         Device &device;
 
         VkImage image;
-        VkDeviceMemory imageMemory;
+        MemoryAllocator::Allocation imageMemory;
 
         uint32_t width;
         uint32_t height;
@@ -16,14 +16,15 @@ namespace Engine {
            glm::abs(rotate.y) > std::numeric_limits<float>::epsilon() ||
            glm::abs(rotate.z) > std::numeric_limits<float>::epsilon()) {
             // We normalize the rotation angles so that rotation in both axis are equivalent
-            gameObject.getTransformComponent()->rotation += glm::normalize(rotate) * lookSpeed * deltaTime;
+            glm::vec3 rotation = gameObject.getTransformComponent()->getRotation() + glm::normalize(rotate) * lookSpeed * deltaTime;
 
             // We clamp the x value and wrap the y value to keep the camera stable and avoid floating point errors
-            gameObject.getTransformComponent()->rotation.x = glm::clamp(gameObject.getTransformComponent()->rotation.x, -1.5f, 1.5f);
-            gameObject.getTransformComponent()->rotation.y = glm::mod(gameObject.getTransformComponent()->rotation.y, glm::two_pi<float>());
+            rotation.x = glm::clamp(rotation.x, -1.5f, 1.5f);
+            rotation.y = glm::mod(rotation.y, glm::two_pi<float>());
+            gameObject.getTransformComponent()->setRotation(rotation);
         }
 
-        float yaw = gameObject.getTransformComponent()->rotation.y;
+        float yaw = gameObject.getTransformComponent()->getRotation().y;
         const glm::vec3 forwardVector{glm::sin(yaw), 0.0f, glm::cos(yaw)};
         const glm::vec3 rightVector{forwardVector.z, 0.0f, -forwardVector.x};
         const glm::vec3 upVector{0.0f, -1.0f, 0.0f};
@@ -42,7 +43,8 @@ namespace Engine {
         if(glm::abs(moveVector.x) > std::numeric_limits<float>::epsilon() ||
            glm::abs(moveVector.y) > std::numeric_limits<float>::epsilon() ||
            glm::abs(moveVector.z) > std::numeric_limits<float>::epsilon()) {
-            gameObject.getTransformComponent()->position += glm::normalize(moveVector) * moveSpeed * deltaTime;
+            TransformComponent *transform = gameObject.getTransformComponent();
+            transform->setPosition(transform->getPosition() + glm::normalize(moveVector) * moveSpeed * deltaTime);
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace Engine {
+    ThreadPool::ThreadPool(uint32_t threadCount) {
+        workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{tasksMutex};
+            stopping = true;
+        } tasksAvailable.notify_all();
+
+        for (auto &worker : workers) worker.join();
+    }
+
+    uint32_t ThreadPool::defaultThreadCount() {
+        uint32_t cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 0;
+    }
+
+    void ThreadPool::submit(std::function<void()> task) {
+        if (workers.empty()) {
+            task(); // Nobody else would ever run it
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{tasksMutex};
+            tasks.push(std::move(task));
+        } tasksAvailable.notify_one();
+    }
+
+    void ThreadPool::parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)> &func) {
+        if (count == 0) return;
+        minChunkSize = std::max<size_t>(minChunkSize, 1);
+
+        const size_t chunkCount = std::min<size_t>(workers.size() + 1, (count + minChunkSize - 1) / minChunkSize);
+        if (chunkCount <= 1) {
+            func(0, count);
+            return;
+        }
+
+        // Chunks catch what they throw, the first exception is rethrown once every chunk is done with the locals here
+        std::exception_ptr firstException;
+        std::mutex exceptionMutex;
+        const auto runChunk = [&func, &firstException, &exceptionMutex](size_t begin, size_t end) {
+            try {
+                if (begin < end) func(begin, end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{exceptionMutex};
+                if (!firstException) firstException = std::current_exception();
+            }
+        };
+
+        const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        std::atomic<size_t> remaining{chunkCount - 1};
+        for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+            const size_t begin = std::min(count, chunk * chunkSize);
+            const size_t end = std::min(count, begin + chunkSize);
+            submit([&runChunk, &remaining, begin, end] {
+                runChunk(begin, end);
+                remaining.fetch_sub(1, std::memory_order_acq_rel);
+            });
+        }
+
+        // The calling thread takes the first chunk
+        runChunk(0, chunkSize);
+        waitFor(remaining);
+
+        if (firstException) std::rethrow_exception(firstException);
+    }
+
+    void ThreadPool::waitFor(const std::atomic<size_t> &counter) {
+        while (counter.load(std::memory_order_acquire) > 0)
+            if (!runPendingTask()) std::this_thread::yield();
+    }
+
+    void ThreadPool::workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock{tasksMutex};
+                tasksAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            } task();
+        }
+    }
+
+    bool ThreadPool::runPendingTask() {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock{tasksMutex};
+            if (tasks.empty()) return false;
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        } task();
+        return true;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+namespace Engine {
+    // A fixed set of worker threads pulling tasks from a shared queue.
+    // Threads waiting on work they submitted help running queued tasks instead of blocking, so it's safe to call
+    // parallelFor from inside a task.
+    class ThreadPool {
+    public:
+        // By default, one worker per core, leaving one for the main thread
+        explicit ThreadPool(uint32_t threadCount = defaultThreadCount());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+        void submit(std::function<void()> task);
+
+        // Splits [0, count) in chunks of at least minChunkSize elements, runs func(begin, end) on each of them across the
+        // workers and the calling thread, and returns once all of them are done. If any chunk throws, the first
+        // exception is rethrown after that.
+        void parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)> &func);
+
+        // Runs queued tasks on the calling thread until counter drops to zero
+        void waitFor(const std::atomic<size_t> &counter);
+
+        // Runs one queued task on the calling thread, returns false if there was none
+        bool runPendingTask();
+
+        static uint32_t defaultThreadCount();
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex tasksMutex;
+        std::condition_variable tasksAvailable;
+        bool stopping = false;
+
+        void workerLoop();
+    };
+}
+
+#endif
@@ -0,0 +1,34 @@
+#include "cpufeatures.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace Engine {
+    static bool queryAvx2() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4]; // EAX, EBX, ECX, EDX
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+
+        // FMA, AVX, and OSXSAVE, then the OS has to save the YMM registers on context switches (XCR0 bits 1 and 2)
+        __cpuid(info, 1);
+        const bool fma = info[2] & (1 << 12);
+        const bool osxsave = info[2] & (1 << 27);
+        const bool avx = info[2] & (1 << 28);
+        if (!fma || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+        __cpuidex(info, 7, 0);
+        return info[1] & (1 << 5);
+#else
+        return false;
+#endif
+    }
+
+    bool cpuSupportsAvx2() {
+        static const bool supported = queryAvx2();
+        return supported;
+    }
+}
@@ -0,0 +1,11 @@
+#ifndef CPUFEATURES_HPP
+#define CPUFEATURES_HPP
+
+// Runtime instruction set checks for the SIMD kernels, whose wider back-ends are compiled with their own flags and
+// must only be called once the CPU (and OS, for the wider registers) is known to support them
+namespace Engine {
+    // AVX2 and FMA, queried once and cached
+    bool cpuSupportsAvx2();
+}
+
+#endif
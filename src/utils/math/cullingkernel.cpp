@@ -0,0 +1,99 @@
+#include "cullingkernel.hpp"
+#include "cpufeatures.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CULLINGKERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Engine::CullingKernel {
+    namespace detail {
+        size_t testScalar(const SphereArrays &in, size_t begin, size_t end, const Planes &planes, uint8_t *visible) {
+            size_t visibleCount = 0;
+            for (size_t i = begin; i < end; i++) {
+                const glm::vec3 center{in.centerX[i], in.centerY[i], in.centerZ[i]};
+
+                bool inside = true;
+                for (const auto &plane : planes) inside &= glm::dot(glm::vec3{plane}, center) + plane.w >= -in.radius[i];
+
+                visible[i] = inside ? 1 : 0;
+                visibleCount += inside;
+            } return visibleCount;
+        }
+
+#ifdef CULLINGKERNEL_SSE2
+        // SSE2 is part of x86-64, so this one doesn't need a runtime check
+        size_t testSse2(const SphereArrays &in, size_t count, const Planes &planes, uint8_t *visible) {
+            __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (size_t p = 0; p < planes.size(); p++) {
+                planeX[p] = _mm_set1_ps(planes[p].x);
+                planeY[p] = _mm_set1_ps(planes[p].y);
+                planeZ[p] = _mm_set1_ps(planes[p].z);
+                planeW[p] = _mm_set1_ps(planes[p].w);
+            }
+
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const __m128 x = _mm_loadu_ps(in.centerX + i);
+                const __m128 y = _mm_loadu_ps(in.centerY + i);
+                const __m128 z = _mm_loadu_ps(in.centerZ + i);
+                const __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(in.radius + i), _mm_set1_ps(-0.0f));
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (size_t p = 0; p < planes.size(); p++) {
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], x), planeW[p]);
+                    distance = _mm_add_ps(_mm_mul_ps(planeY[p], y), distance);
+                    distance = _mm_add_ps(_mm_mul_ps(planeZ[p], z), distance);
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+                }
+
+                const int mask = _mm_movemask_ps(inside);
+                for (size_t lane = 0; lane < 4; lane++) visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+            } return i;
+        }
+#else
+        size_t testSse2(const SphereArrays &, size_t, const Planes &, uint8_t *) { return 0; }
+#endif
+    }
+
+    static bool avx2Available() {
+        return detail::avx2Compiled() && cpuSupportsAvx2();
+    }
+
+    Path getActivePath() {
+        static const Path path = [] {
+            if (avx2Available()) return Path::AVX2;
+#ifdef CULLINGKERNEL_SSE2
+            return Path::SSE2;
+#else
+            return Path::SCALAR;
+#endif
+        }();
+        return path;
+    }
+
+    const char *getPathName(Path path) {
+        switch (path) {
+            case Path::SCALAR: return "scalar";
+            case Path::SSE2: return "SSE2";
+            case Path::AVX2: return "AVX2";
+        } return "unknown";
+    }
+
+    size_t testSpheres(const SphereArrays &spheres, size_t count, const Planes &planes, uint8_t *visible) {
+        return testSpheres(getActivePath(), spheres, count, planes, visible);
+    }
+
+    size_t testSpheres(Path path, const SphereArrays &spheres, size_t count, const Planes &planes, uint8_t *visible) {
+        size_t done = 0;
+        if (path == Path::AVX2 && avx2Available()) done = detail::testAvx2(spheres, count, planes, visible);
+        else if (path != Path::SCALAR) done = detail::testSse2(spheres, count, planes, visible);
+
+        // The SIMD paths only write the flags, counting them once is cheaper than keeping a running sum per batch
+        size_t visibleCount = 0;
+        for (size_t i = 0; i < done; i++) visibleCount += visible[i];
+
+        // Leftovers that don't fill a whole batch
+        return visibleCount + detail::testScalar(spheres, done, count, planes, visible);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef CULLINGKERNEL_HPP
+#define CULLINGKERNEL_HPP
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Batched sphere against frustum tests, several spheres at once with SIMD.
+// A sphere is visible unless it lies entirely behind one of the planes: dot(normal, center) + d < -radius.
+namespace Engine::CullingKernel {
+    // Structure of arrays input, every array holds `count` floats, all in the same space as the planes
+    struct SphereArrays {
+        const float *centerX;
+        const float *centerY;
+        const float *centerZ;
+        const float *radius;
+    };
+
+    // Normals pointing inwards, see Camera::getFrustumPlanes
+    using Planes = std::array<glm::vec4, 6>;
+
+    enum class Path {
+        SCALAR,
+        SSE2, // 4 spheres at once
+        AVX2, // 8 spheres at once
+    };
+
+    // Writes 1 to visible[i] for every sphere at least partially inside the frustum and 0 for the rest, using the widest
+    // instruction set the CPU supports. Returns how many are visible.
+    size_t testSpheres(const SphereArrays &spheres, size_t count, const Planes &planes, uint8_t *visible);
+
+    // Same as above, forcing a specific path, mostly useful to compare them. Falls back to scalar if unsupported.
+    size_t testSpheres(Path path, const SphereArrays &spheres, size_t count, const Planes &planes, uint8_t *visible);
+
+    // The path testSpheres picks on this CPU
+    Path getActivePath();
+    const char *getPathName(Path path);
+
+    namespace detail {
+        size_t testScalar(const SphereArrays &spheres, size_t begin, size_t end, const Planes &planes, uint8_t *visible);
+
+        // Both return the first index they didn't process, the remainder is left for the scalar path
+        size_t testSse2(const SphereArrays &spheres, size_t count, const Planes &planes, uint8_t *visible);
+        size_t testAvx2(const SphereArrays &spheres, size_t count, const Planes &planes, uint8_t *visible);
+        bool avx2Compiled();
+    }
+}
+
+#endif
@@ -0,0 +1,46 @@
+#include "cullingkernel.hpp"
+
+// Built with AVX2 and FMA enabled (see CMakeLists.txt), only ever called after checking the CPU supports them
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER)) // MSVC never defines __FMA__, /arch:AVX2 implies it
+#include <immintrin.h>
+
+namespace Engine::CullingKernel::detail {
+    bool avx2Compiled() { return true; }
+
+    size_t testAvx2(const SphereArrays &in, size_t count, const Planes &planes, uint8_t *visible) {
+        __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (size_t p = 0; p < planes.size(); p++) {
+            planeX[p] = _mm256_set1_ps(planes[p].x);
+            planeY[p] = _mm256_set1_ps(planes[p].y);
+            planeZ[p] = _mm256_set1_ps(planes[p].z);
+            planeW[p] = _mm256_set1_ps(planes[p].w);
+        }
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m256 x = _mm256_loadu_ps(in.centerX + i);
+            const __m256 y = _mm256_loadu_ps(in.centerY + i);
+            const __m256 z = _mm256_loadu_ps(in.centerZ + i);
+            const __m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(in.radius + i), _mm256_set1_ps(-0.0f));
+
+            // All six planes for 8 spheres, no early out, branches would cost more than the remaining planes
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (size_t p = 0; p < planes.size(); p++) {
+                __m256 distance = _mm256_fmadd_ps(planeX[p], x, planeW[p]);
+                distance = _mm256_fmadd_ps(planeY[p], y, distance);
+                distance = _mm256_fmadd_ps(planeZ[p], z, distance);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+
+            // One bit per sphere, spread to one byte each
+            const auto mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+            for (size_t lane = 0; lane < 8; lane++) visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        } return i;
+    }
+}
+#else
+namespace Engine::CullingKernel::detail {
+    bool avx2Compiled() { return false; }
+    size_t testAvx2(const SphereArrays &, size_t, const Planes &, uint8_t *) { return 0; }
+}
+#endif
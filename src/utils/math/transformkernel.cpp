@@ -0,0 +1,123 @@
+#include "transformkernel.hpp"
+#include "cpufeatures.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TRANSFORMKERNEL_SSE2
+#include <emmintrin.h>
+#include "transformkernel_simd.hpp"
+#endif
+
+namespace Engine::TransformKernel {
+    namespace detail {
+        void computeScalar(const TransformArrays &in, size_t begin, size_t end, glm::mat4 *models, glm::mat3 *normals) {
+            for (size_t i = begin; i < end; i++) {
+                const float c3 = std::cos(in.rotationZ[i]);
+                const float s3 = std::sin(in.rotationZ[i]);
+                const float c2 = std::cos(in.rotationY[i]);
+                const float s2 = std::sin(in.rotationY[i]);
+                const float c1 = std::cos(in.rotationX[i]);
+                const float s1 = std::sin(in.rotationX[i]);
+
+                const glm::vec3 r0{c2 * c3, c1 * s3 + s1 * c3 * s2, s1 * s3 - c1 * c3 * s2};
+                const glm::vec3 r1{-c2 * s3, c1 * c3 - s1 * s3 * s2, s1 * c3 + c1 * s3 * s2};
+                const glm::vec3 r2{s2, -c2 * s1, c2 * c1};
+                const glm::vec3 scale{in.scaleX[i], in.scaleY[i], in.scaleZ[i]};
+
+                models[i] = glm::mat4{
+                    glm::vec4{r0 * scale.x, 0.0f},
+                    glm::vec4{r1 * scale.y, 0.0f},
+                    glm::vec4{r2 * scale.z, 0.0f},
+                    glm::vec4{in.positionX[i], in.positionY[i], in.positionZ[i], 1.0f},
+                };
+
+                const glm::vec3 invScale = 1.0f / scale;
+                normals[i] = glm::mat3{r0 * invScale.x, r1 * invScale.y, r2 * invScale.z};
+            }
+        }
+
+#ifdef TRANSFORMKERNEL_SSE2
+        // SSE2 is part of x86-64, so this one doesn't need a runtime check
+        struct Sse2 {
+            using F = __m128;
+            using I = __m128i;
+            static constexpr size_t WIDTH = 4;
+
+            static F load(const float *p) { return _mm_loadu_ps(p); }
+            static void store(float *p, F v) { _mm_store_ps(p, v); }
+            static F set1(float v) { return _mm_set1_ps(v); }
+            static F add(F a, F b) { return _mm_add_ps(a, b); }
+            static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+            static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+            static F div(F a, F b) { return _mm_div_ps(a, b); }
+            static F fmadd(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+            static I roundToInt(F v) { return _mm_cvtps_epi32(v); }
+            static F toFloat(I v) { return _mm_cvtepi32_ps(v); }
+            static I addInt(I v, int x) { return _mm_add_epi32(v, _mm_set1_epi32(x)); }
+            static F bitSet(I v, int bit) {
+                const I mask = _mm_set1_epi32(bit);
+                return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(v, mask), mask));
+            }
+            static F select(F mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+            static F negateWhere(F mask, F v) { return _mm_xor_ps(v, _mm_and_ps(mask, _mm_set1_ps(-0.0f))); }
+        };
+
+        size_t computeSse2(const TransformArrays &in, size_t count, glm::mat4 *models, glm::mat3 *normals) {
+            return computeBatches<Sse2>(in, count, models, normals);
+        }
+#else
+        size_t computeSse2(const TransformArrays &, size_t, glm::mat4 *, glm::mat3 *) { return 0; }
+#endif
+    }
+
+    static bool avx2Available() {
+        return detail::avx2Compiled() && cpuSupportsAvx2();
+    }
+
+    Path getActivePath() {
+        static const Path path = [] {
+            if (avx2Available()) return Path::AVX2;
+#ifdef TRANSFORMKERNEL_SSE2
+            return Path::SSE2;
+#else
+            return Path::SCALAR;
+#endif
+        }();
+        return path;
+    }
+
+    Path resolvePath(Path path) {
+        if (path == Path::SCALAR || (path == Path::AVX2 && avx2Available())) return path;
+#ifdef TRANSFORMKERNEL_SSE2
+        return Path::SSE2;
+#else
+        return Path::SCALAR;
+#endif
+    }
+
+    const char *getPathName(Path path) {
+        switch (path) {
+            case Path::SCALAR: return "scalar";
+            case Path::SSE2: return "SSE2";
+            case Path::AVX2: return "AVX2";
+        } return "unknown";
+    }
+
+    void computeMatrices(const TransformArrays &transforms, size_t count, glm::mat4 *models, glm::mat3 *normals) {
+        computeMatrices(getActivePath(), transforms, count, models, normals);
+    }
+
+    void computeMatrices(Path path, const TransformArrays &transforms, size_t count, glm::mat4 *models, glm::mat3 *normals) {
+        size_t done = 0;
+        switch (resolvePath(path)) {
+            case Path::AVX2: done = detail::computeAvx2(transforms, count, models, normals); break;
+            case Path::SSE2: done = detail::computeSse2(transforms, count, models, normals); break;
+            case Path::SCALAR: break;
+        }
+
+        // Leftovers that don't fill a whole batch
+        detail::computeScalar(transforms, done, count, models, normals);
+    }
+}
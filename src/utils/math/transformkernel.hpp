@@ -0,0 +1,56 @@
+#ifndef TRANSFORMKERNEL_HPP
+#define TRANSFORMKERNEL_HPP
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Batched model and normal matrix computation, working on several transforms at once with SIMD.
+// The math is the same as TransformComponent::computeMat4() and TransformComponent::computeNormal(), just expanded into
+// closed form: Translate * Rx * Ry * Rz * Scale, and R * Scale^-1 for the normal matrix.
+namespace Engine::TransformKernel {
+    // Structure of arrays input, every array holds `count` floats
+    struct TransformArrays {
+        const float *positionX;
+        const float *positionY;
+        const float *positionZ;
+        const float *rotationX;
+        const float *rotationY;
+        const float *rotationZ;
+        const float *scaleX;
+        const float *scaleY;
+        const float *scaleZ;
+    };
+
+    enum class Path {
+        SCALAR,
+        SSE2, // 4 transforms at once
+        AVX2, // 8 transforms at once
+    };
+
+    // Writes models[i] and normals[i] for every i in [0, count), using the widest instruction set the CPU supports
+    void computeMatrices(const TransformArrays &transforms, size_t count, glm::mat4 *models, glm::mat3 *normals);
+
+    // Same as above, forcing a specific path, mostly useful to compare them. An unsupported path falls back to the next
+    // narrower one (see resolvePath).
+    void computeMatrices(Path path, const TransformArrays &transforms, size_t count, glm::mat4 *models, glm::mat3 *normals);
+
+    // The path computeMatrices picks on this CPU
+    Path getActivePath();
+    // The path computeMatrices actually takes on this CPU when asked for `path`
+    Path resolvePath(Path path);
+    const char *getPathName(Path path);
+
+    namespace detail {
+        void computeScalar(const TransformArrays &transforms, size_t begin, size_t end, glm::mat4 *models, glm::mat3 *normals);
+
+        // Both return the first index they didn't process, the remainder is left for the scalar path
+        size_t computeSse2(const TransformArrays &transforms, size_t count, glm::mat4 *models, glm::mat3 *normals);
+        size_t computeAvx2(const TransformArrays &transforms, size_t count, glm::mat4 *models, glm::mat3 *normals);
+        bool avx2Compiled();
+    }
+}
+
+#endif
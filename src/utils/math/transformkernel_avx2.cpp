@@ -0,0 +1,45 @@
+#include "transformkernel.hpp"
+
+// Built with AVX2 and FMA enabled (see CMakeLists.txt), only ever called after checking the CPU supports them
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER)) // MSVC never defines __FMA__, /arch:AVX2 implies it
+#include <immintrin.h>
+#include "transformkernel_simd.hpp"
+
+namespace Engine::TransformKernel::detail {
+    struct Avx2 {
+        using F = __m256;
+        using I = __m256i;
+        static constexpr size_t WIDTH = 8;
+
+        static F load(const float *p) { return _mm256_loadu_ps(p); }
+        static void store(float *p, F v) { _mm256_store_ps(p, v); }
+        static F set1(float v) { return _mm256_set1_ps(v); }
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static F div(F a, F b) { return _mm256_div_ps(a, b); }
+        static F fmadd(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+
+        static I roundToInt(F v) { return _mm256_cvtps_epi32(v); }
+        static F toFloat(I v) { return _mm256_cvtepi32_ps(v); }
+        static I addInt(I v, int x) { return _mm256_add_epi32(v, _mm256_set1_epi32(x)); }
+        static F bitSet(I v, int bit) {
+            const I mask = _mm256_set1_epi32(bit);
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(v, mask), mask));
+        }
+        static F select(F mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+        static F negateWhere(F mask, F v) { return _mm256_xor_ps(v, _mm256_and_ps(mask, _mm256_set1_ps(-0.0f))); }
+    };
+
+    bool avx2Compiled() { return true; }
+
+    size_t computeAvx2(const TransformArrays &in, size_t count, glm::mat4 *models, glm::mat3 *normals) {
+        return computeBatches<Avx2>(in, count, models, normals);
+    }
+}
+#else
+namespace Engine::TransformKernel::detail {
+    bool avx2Compiled() { return false; }
+    size_t computeAvx2(const TransformArrays &, size_t, glm::mat4 *, glm::mat3 *) { return 0; }
+}
+#endif
@@ -0,0 +1,127 @@
+#ifndef TRANSFORMKERNEL_SIMD_HPP
+#define TRANSFORMKERNEL_SIMD_HPP
+
+#include "transformkernel.hpp"
+
+// Instruction set agnostic implementation of the transform kernel.
+// Every back-end includes this with its own traits struct (Isa), which provides the vector types (F for floats, I for
+// integers), its WIDTH, and the handful of operations used below. Each back-end lives in its own translation unit, so
+// it can be compiled with the right flags.
+namespace Engine::TransformKernel::detail {
+    // Cephes style sincos: reduce to [-pi/4, pi/4] around the closest multiple of pi/2, then evaluate both polynomials
+    // and pick/negate them depending on the quadrant. Good to ~1e-7 for the angle range used by transforms.
+    template<typename Isa>
+    inline void sincos(typename Isa::F x, typename Isa::F &sinOut, typename Isa::F &cosOut) {
+        using F = typename Isa::F;
+        using I = typename Isa::I;
+
+        const I quadrant = Isa::roundToInt(Isa::mul(x, Isa::set1(0.636619772367581343f))); // x * 2 / pi
+        const F j = Isa::toFloat(quadrant);
+
+        // Extended precision modular arithmetic, pi / 2 split in three parts
+        F r = Isa::fmadd(j, Isa::set1(-1.5703125f), x);
+        r = Isa::fmadd(j, Isa::set1(-4.837512969970703125e-4f), r);
+        r = Isa::fmadd(j, Isa::set1(-7.549789948768648e-8f), r);
+
+        const F r2 = Isa::mul(r, r);
+
+        F sinPoly = Isa::fmadd(Isa::set1(-1.9515295891e-4f), r2, Isa::set1(8.3321608736e-3f));
+        sinPoly = Isa::fmadd(sinPoly, r2, Isa::set1(-1.6666654611e-1f));
+        sinPoly = Isa::fmadd(Isa::mul(sinPoly, r2), r, r);
+
+        F cosPoly = Isa::fmadd(Isa::set1(2.443315711809948e-5f), r2, Isa::set1(-1.388731625493765e-3f));
+        cosPoly = Isa::fmadd(cosPoly, r2, Isa::set1(4.166664568298827e-2f));
+        cosPoly = Isa::fmadd(Isa::mul(cosPoly, r2), r2, Isa::fmadd(Isa::set1(-0.5f), r2, Isa::set1(1.0f)));
+
+        // Odd quadrants swap sin and cos, quadrants 2 and 3 negate sin, quadrants 1 and 2 negate cos
+        const F swap = Isa::bitSet(quadrant, 1);
+        const F s = Isa::select(swap, cosPoly, sinPoly);
+        const F c = Isa::select(swap, sinPoly, cosPoly);
+
+        sinOut = Isa::negateWhere(Isa::bitSet(quadrant, 2), s);
+        cosOut = Isa::negateWhere(Isa::bitSet(Isa::addInt(quadrant, 1), 2), c);
+    }
+
+    // Processes as many full batches of Isa::WIDTH transforms as fit in count, returns the first unprocessed index
+    template<typename Isa>
+    size_t computeBatches(const TransformArrays &in, size_t count, glm::mat4 *models, glm::mat3 *normals) {
+        using F = typename Isa::F;
+        constexpr size_t W = Isa::WIDTH;
+
+        // The results are computed as structure of arrays, then scattered into the matrices
+        alignas(32) float model[12][W];
+        alignas(32) float normal[9][W];
+
+        const F one = Isa::set1(1.0f);
+
+        size_t i = 0;
+        for (; i + W <= count; i += W) {
+            F s1, c1, s2, c2, s3, c3;
+            sincos<Isa>(Isa::load(in.rotationX + i), s1, c1);
+            sincos<Isa>(Isa::load(in.rotationY + i), s2, c2);
+            sincos<Isa>(Isa::load(in.rotationZ + i), s3, c3);
+
+            const F c3s2 = Isa::mul(c3, s2);
+            const F s3s2 = Isa::mul(s3, s2);
+
+            // Rotation matrix columns
+            const F r00 = Isa::mul(c2, c3);
+            const F r01 = Isa::fmadd(s1, c3s2, Isa::mul(c1, s3));
+            const F r02 = Isa::sub(Isa::mul(s1, s3), Isa::mul(c1, c3s2));
+
+            const F r10 = Isa::sub(Isa::set1(0.0f), Isa::mul(c2, s3));
+            const F r11 = Isa::sub(Isa::mul(c1, c3), Isa::mul(s1, s3s2));
+            const F r12 = Isa::fmadd(c1, s3s2, Isa::mul(s1, c3));
+
+            const F r20 = s2;
+            const F r21 = Isa::sub(Isa::set1(0.0f), Isa::mul(s1, c2));
+            const F r22 = Isa::mul(c1, c2);
+
+            const F sx = Isa::load(in.scaleX + i);
+            const F sy = Isa::load(in.scaleY + i);
+            const F sz = Isa::load(in.scaleZ + i);
+
+            Isa::store(model[0], Isa::mul(r00, sx));
+            Isa::store(model[1], Isa::mul(r01, sx));
+            Isa::store(model[2], Isa::mul(r02, sx));
+            Isa::store(model[3], Isa::mul(r10, sy));
+            Isa::store(model[4], Isa::mul(r11, sy));
+            Isa::store(model[5], Isa::mul(r12, sy));
+            Isa::store(model[6], Isa::mul(r20, sz));
+            Isa::store(model[7], Isa::mul(r21, sz));
+            Isa::store(model[8], Isa::mul(r22, sz));
+            Isa::store(model[9], Isa::load(in.positionX + i));
+            Isa::store(model[10], Isa::load(in.positionY + i));
+            Isa::store(model[11], Isa::load(in.positionZ + i));
+
+            const F xinv = Isa::div(one, sx);
+            const F yinv = Isa::div(one, sy);
+            const F zinv = Isa::div(one, sz);
+
+            Isa::store(normal[0], Isa::mul(r00, xinv));
+            Isa::store(normal[1], Isa::mul(r01, xinv));
+            Isa::store(normal[2], Isa::mul(r02, xinv));
+            Isa::store(normal[3], Isa::mul(r10, yinv));
+            Isa::store(normal[4], Isa::mul(r11, yinv));
+            Isa::store(normal[5], Isa::mul(r12, yinv));
+            Isa::store(normal[6], Isa::mul(r20, zinv));
+            Isa::store(normal[7], Isa::mul(r21, zinv));
+            Isa::store(normal[8], Isa::mul(r22, zinv));
+
+            for (size_t lane = 0; lane < W; lane++) {
+                glm::mat4 &m = models[i + lane];
+                m[0] = {model[0][lane], model[1][lane], model[2][lane], 0.0f};
+                m[1] = {model[3][lane], model[4][lane], model[5][lane], 0.0f};
+                m[2] = {model[6][lane], model[7][lane], model[8][lane], 0.0f};
+                m[3] = {model[9][lane], model[10][lane], model[11][lane], 1.0f};
+
+                glm::mat3 &n = normals[i + lane];
+                n[0] = {normal[0][lane], normal[1][lane], normal[2][lane]};
+                n[1] = {normal[3][lane], normal[4][lane], normal[5][lane]};
+                n[2] = {normal[6][lane], normal[7][lane], normal[8][lane]};
+            }
+        } return i;
+    }
+}
+
+#endif
@@ -0,0 +1,523 @@
+#include "memoryallocator.hpp"
+
+#include <bit>
+#include <cassert>
+#include <algorithm>
+#include <stdexcept>
+
+namespace Engine {
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    TlsfAllocator::TlsfAllocator(VkDeviceSize size) : totalSize(size) {
+        assert(size >= MIN_ALIGNMENT && size % MIN_ALIGNMENT == 0 && "Invalid TLSF allocator size!");
+        for (auto &heads : freeHeads) heads.fill(INVALID_NODE);
+        insertFree(createNode(0, size));
+    }
+
+    void TlsfAllocator::mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl) {
+        fl = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        sl = static_cast<uint32_t>(size >> (fl - SL_BITS)) & (SL_COUNT - 1);
+    }
+
+    uint32_t TlsfAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+        assert(std::has_single_bit(alignment) && "Alignment must be a power of two!");
+        size = alignUp(std::max<VkDeviceSize>(size, 1), MIN_ALIGNMENT);
+        alignment = std::max(alignment, MIN_ALIGNMENT);
+        if (size > totalSize) return INVALID_NODE;
+
+        // Room for the worst case padding, rounded up to the next size class so that any free range found there fits
+        VkDeviceSize searchSize = size + alignment - MIN_ALIGNMENT;
+        const auto top = static_cast<uint32_t>(std::bit_width(searchSize)) - 1;
+        searchSize += (VkDeviceSize{1} << (top - SL_BITS)) - 1;
+
+        uint32_t fl, sl;
+        mapping(searchSize, fl, sl);
+
+        uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+        if (slMap == 0) {
+            const uint64_t flMap = fl + 1 < FL_COUNT ? flBitmap & (~0ull << (fl + 1)) : 0;
+            if (flMap == 0) return INVALID_NODE;
+
+            fl = static_cast<uint32_t>(std::countr_zero(flMap));
+            slMap = slBitmaps[fl];
+        }
+        sl = static_cast<uint32_t>(std::countr_zero(slMap));
+
+        const uint32_t node = freeHeads[fl][sl];
+        removeFree(node);
+
+        // Give the padding in front back as a range of its own. The neighbours of a free range are always used, so
+        // neither this nor the remainder below need merging
+        const VkDeviceSize padding = alignUp(nodes[node].offset, alignment) - nodes[node].offset;
+        if (padding > 0) {
+            const uint32_t front = createNode(nodes[node].offset, padding);
+            const uint32_t prev = nodes[node].prevPhysical;
+            nodes[front].prevPhysical = prev;
+            nodes[front].nextPhysical = node;
+            if (prev != INVALID_NODE) nodes[prev].nextPhysical = front;
+            nodes[node].prevPhysical = front;
+            nodes[node].offset += padding;
+            nodes[node].size -= padding;
+            insertFree(front);
+        }
+
+        if (nodes[node].size > size) {
+            const uint32_t back = createNode(nodes[node].offset + size, nodes[node].size - size);
+            const uint32_t next = nodes[node].nextPhysical;
+            nodes[back].prevPhysical = node;
+            nodes[back].nextPhysical = next;
+            if (next != INVALID_NODE) nodes[next].prevPhysical = back;
+            nodes[node].nextPhysical = back;
+            nodes[node].size = size;
+            insertFree(back);
+        }
+
+        nodes[node].free = false;
+        usedBytes += size;
+        allocationCount++;
+        return node;
+    }
+
+    void TlsfAllocator::free(uint32_t node) {
+        assert(node < nodes.size() && !nodes[node].free && "Freeing a range that isn't allocated!");
+        usedBytes -= nodes[node].size;
+        allocationCount--;
+
+        const uint32_t prev = nodes[node].prevPhysical;
+        if (prev != INVALID_NODE && nodes[prev].free) {
+            removeFree(prev);
+            merge(prev, node);
+            node = prev;
+        }
+
+        const uint32_t next = nodes[node].nextPhysical;
+        if (next != INVALID_NODE && nodes[next].free) {
+            removeFree(next);
+            merge(node, next);
+        }
+
+        insertFree(node);
+    }
+
+    VkDeviceSize TlsfAllocator::getLargestFreeRange() const {
+        if (flBitmap == 0) return 0;
+
+        // Only the highest size class can hold it, but ranges within a class differ in size
+        const auto fl = static_cast<uint32_t>(63 - std::countl_zero(flBitmap));
+        const auto sl = static_cast<uint32_t>(31 - std::countl_zero(slBitmaps[fl]));
+
+        VkDeviceSize largest = 0;
+        for (uint32_t node = freeHeads[fl][sl]; node != INVALID_NODE; node = nodes[node].nextFree)
+            largest = std::max(largest, nodes[node].size);
+        return largest;
+    }
+
+    uint32_t TlsfAllocator::createNode(VkDeviceSize offset, VkDeviceSize size) {
+        uint32_t node;
+        if (!unusedNodes.empty()) {
+            node = unusedNodes.back();
+            unusedNodes.pop_back();
+        } else {
+            node = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+
+        nodes[node] = {offset, size, INVALID_NODE, INVALID_NODE, INVALID_NODE, INVALID_NODE, false};
+        return node;
+    }
+
+    void TlsfAllocator::insertFree(uint32_t node) {
+        uint32_t fl, sl;
+        mapping(nodes[node].size, fl, sl);
+
+        const uint32_t head = freeHeads[fl][sl];
+        nodes[node].free = true;
+        nodes[node].prevFree = INVALID_NODE;
+        nodes[node].nextFree = head;
+        if (head != INVALID_NODE) nodes[head].prevFree = node;
+
+        freeHeads[fl][sl] = node;
+        slBitmaps[fl] |= 1u << sl;
+        flBitmap |= 1ull << fl;
+    }
+
+    void TlsfAllocator::removeFree(uint32_t node) {
+        uint32_t fl, sl;
+        mapping(nodes[node].size, fl, sl);
+
+        const uint32_t prev = nodes[node].prevFree;
+        const uint32_t next = nodes[node].nextFree;
+        if (prev != INVALID_NODE) nodes[prev].nextFree = next;
+        if (next != INVALID_NODE) nodes[next].prevFree = prev;
+        nodes[node].free = false;
+
+        if (freeHeads[fl][sl] != node) return;
+        freeHeads[fl][sl] = next;
+        if (next == INVALID_NODE) {
+            slBitmaps[fl] &= ~(1u << sl);
+            if (slBitmaps[fl] == 0) flBitmap &= ~(1ull << fl);
+        }
+    }
+
+    void TlsfAllocator::merge(uint32_t node, uint32_t next) {
+        assert(nodes[node].nextPhysical == next && "Only physical neighbours can be merged!");
+        const uint32_t after = nodes[next].nextPhysical;
+        nodes[node].size += nodes[next].size;
+        nodes[node].nextPhysical = after;
+        if (after != INVALID_NODE) nodes[after].prevPhysical = node;
+        unusedNodes.push_back(next);
+    }
+
+    MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, bool memoryBudget) :
+        device(device), physicalDevice(physicalDevice), memoryBudget(memoryBudget) {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+        memoryTypes.resize(memoryProperties.memoryTypeCount);
+        heaps.resize(memoryProperties.memoryHeapCount);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+            heaps[i].budget = static_cast<VkDeviceSize>(static_cast<double>(memoryProperties.memoryHeaps[i].size) *
+                                                        DEFAULT_BUDGET_RATIO);
+        updateBudget();
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        // Whatever is still allocated goes away with its block, dedicated allocations are on their owners
+        for (uint32_t i = 0; i < memoryTypes.size(); i++) {
+            for (auto &blocks : memoryTypes[i].blocks)
+                for (auto &block : blocks) freeMemory(i, block->memory, block->size, block->mapped);
+            for (auto &block : memoryTypes[i].linearBlocks) freeMemory(i, block->memory, block->size, block->mapped);
+        }
+    }
+
+    uint32_t MemoryAllocator::findMemoryTypeOrNone(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+            if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+                return i;
+        return NO_MEMORY_TYPE;
+    }
+
+    uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+        const uint32_t memoryType = findMemoryTypeOrNone(typeFilter, properties);
+        if (memoryType == NO_MEMORY_TYPE) throw std::runtime_error("Failed to find suitable memory type!");
+        return memoryType;
+    }
+
+    VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryType) const {
+        const uint32_t heap = memoryProperties.memoryTypes[memoryType].heapIndex;
+        const VkDeviceSize heapSize = memoryProperties.memoryHeaps[heap].size;
+        if (heapSize <= SMALL_HEAP_SIZE) return alignUp(heapSize / 8, TlsfAllocator::MIN_ALIGNMENT);
+        return LARGE_HEAP_BLOCK_SIZE;
+    }
+
+    bool MemoryAllocator::isHostVisible(uint32_t memoryType) const {
+        return memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+
+    MemoryAllocator::Allocation MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                                                          VkMemoryPropertyFlags properties,
+                                                          Usage usage,
+                                                          bool linearResource,
+                                                          VkMemoryPropertyFlags preferredProperties) {
+        Allocation allocation{};
+        allocation.memoryType = findMemoryTypeOrNone(requirements.memoryTypeBits, properties | preferredProperties);
+        if (allocation.memoryType == NO_MEMORY_TYPE)
+            allocation.memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+        allocation.size = requirements.size;
+        allocation.linearResource = linearResource;
+
+        const bool staging = usage == Usage::STAGING && isHostVisible(allocation.memoryType);
+        VkDeviceSize blockSize = getBlockSize(allocation.memoryType);
+        if (staging) blockSize = std::min(blockSize, STAGING_BLOCK_SIZE);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        if (requirements.size > blockSize / 2) allocateDedicated(allocation);
+        else if (staging) allocateLinear(blockSize, requirements, allocation);
+        else allocateFromBlocks(blockSize, requirements, allocation);
+
+        heaps[getHeapIndex(allocation.memoryType)].usedBytes += allocation.size;
+        return allocation;
+    }
+
+    void MemoryAllocator::free(Allocation &allocation) {
+        if (allocation.kind == Allocation::Kind::NONE) return;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        MemoryType &type = memoryTypes[allocation.memoryType];
+        switch (allocation.kind) {
+            case Allocation::Kind::BLOCK: {
+                auto &blocks = type.blocks[allocation.linearResource];
+                auto *block = static_cast<Block*>(allocation.block);
+                block->tlsf.free(allocation.node);
+
+                // Keep the last block around even when empty, so freeing and reallocating doesn't thrash
+                if (block->tlsf.empty() && blocks.size() > 1) {
+                    freeMemory(allocation.memoryType, block->memory, block->size, block->mapped);
+                    std::erase_if(blocks, [block](const auto &b) { return b.get() == block; });
+                } break;
+            }
+            case Allocation::Kind::LINEAR: {
+                auto &blocks = type.linearBlocks;
+                auto *block = static_cast<LinearBlock*>(allocation.block);
+                if (--block->liveCount > 0) break;
+
+                block->head = 0;
+                if (blocks.size() > 1) {
+                    freeMemory(allocation.memoryType, block->memory, block->size, block->mapped);
+                    std::erase_if(blocks, [block](const auto &b) { return b.get() == block; });
+                } break;
+            }
+            case Allocation::Kind::DEDICATED:
+                freeMemory(allocation.memoryType,
+                           allocation.memory,
+                           allocation.size,
+                           static_cast<std::byte*>(allocation.mapped));
+                type.dedicatedCount--;
+                type.dedicatedBytes -= allocation.size;
+                break;
+            case Allocation::Kind::NONE:
+                break;
+        }
+
+        heaps[getHeapIndex(allocation.memoryType)].usedBytes -= allocation.size;
+        allocation = {};
+    }
+
+    VkDeviceSize MemoryAllocator::trim(uint32_t heap) {
+        std::lock_guard<std::mutex> lock{mutex};
+        const VkDeviceSize allocatedBytes = heaps[heap].allocatedBytes;
+        for (uint32_t i = 0; i < memoryTypes.size(); i++) {
+            if (getHeapIndex(i) != heap) continue;
+
+            for (auto &blocks : memoryTypes[i].blocks) {
+                std::erase_if(blocks, [this, i](const auto &block) {
+                    if (!block->tlsf.empty()) return false;
+                    freeMemory(i, block->memory, block->size, block->mapped);
+                    return true;
+                });
+            }
+            std::erase_if(memoryTypes[i].linearBlocks, [this, i](const auto &block) {
+                if (block->liveCount > 0) return false;
+                freeMemory(i, block->memory, block->size, block->mapped);
+                return true;
+            });
+        } return allocatedBytes - heaps[heap].allocatedBytes;
+    }
+
+    VkDeviceMemory MemoryAllocator::allocateMemory(uint32_t memoryType, VkDeviceSize size, std::byte *&mapped) {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate device memory!");
+        heaps[getHeapIndex(memoryType)].allocatedBytes += size;
+
+        mapped = nullptr;
+        if (isHostVisible(memoryType)) {
+            void *data;
+            if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+                freeMemory(memoryType, memory, size, nullptr);
+                throw std::runtime_error("Failed to map device memory!");
+            } mapped = static_cast<std::byte*>(data);
+        } return memory;
+    }
+
+    void MemoryAllocator::freeMemory(uint32_t memoryType, VkDeviceMemory memory, VkDeviceSize size, std::byte *mapped) {
+        if (mapped) vkUnmapMemory(device, memory);
+        vkFreeMemory(device, memory, nullptr);
+        heaps[getHeapIndex(memoryType)].allocatedBytes -= size;
+    }
+
+    void MemoryAllocator::allocateFromBlocks(VkDeviceSize blockSize,
+                                             const VkMemoryRequirements &requirements,
+                                             Allocation &allocation) {
+        auto &blocks = memoryTypes[allocation.memoryType].blocks[allocation.linearResource];
+
+        uint32_t node = TlsfAllocator::INVALID_NODE;
+        Block *block = nullptr;
+        for (auto &candidate : blocks) {
+            node = candidate->tlsf.allocate(requirements.size, requirements.alignment);
+            if (node != TlsfAllocator::INVALID_NODE) {
+                block = candidate.get();
+                break;
+            }
+        }
+
+        if (block == nullptr) {
+            blocks.push_back(std::make_unique<Block>(blockSize));
+            block = blocks.back().get();
+            block->memory = allocateMemory(allocation.memoryType, blockSize, block->mapped);
+            node = block->tlsf.allocate(requirements.size, requirements.alignment);
+            assert(node != TlsfAllocator::INVALID_NODE && "Allocation doesn't fit in an empty block!");
+        }
+
+        allocation.kind = Allocation::Kind::BLOCK;
+        allocation.memory = block->memory;
+        allocation.offset = block->tlsf.getOffset(node);
+        allocation.mapped = block->mapped ? block->mapped + allocation.offset : nullptr;
+        allocation.block = block;
+        allocation.node = node;
+    }
+
+    void MemoryAllocator::allocateLinear(VkDeviceSize blockSize,
+                                         const VkMemoryRequirements &requirements,
+                                         Allocation &allocation) {
+        auto &blocks = memoryTypes[allocation.memoryType].linearBlocks;
+        const VkDeviceSize alignment = std::max(requirements.alignment, TlsfAllocator::MIN_ALIGNMENT);
+
+        LinearBlock *block = nullptr;
+        for (auto &candidate : blocks) {
+            if (alignUp(candidate->head, alignment) + requirements.size <= candidate->size) {
+                block = candidate.get();
+                break;
+            }
+        }
+
+        if (block == nullptr) {
+            blocks.push_back(std::make_unique<LinearBlock>());
+            block = blocks.back().get();
+            block->size = blockSize;
+            block->memory = allocateMemory(allocation.memoryType, blockSize, block->mapped);
+        }
+
+        const VkDeviceSize offset = alignUp(block->head, alignment);
+        block->head = alignUp(offset + requirements.size, TlsfAllocator::MIN_ALIGNMENT);
+        block->liveCount++;
+
+        allocation.kind = Allocation::Kind::LINEAR;
+        allocation.memory = block->memory;
+        allocation.offset = offset;
+        allocation.mapped = block->mapped + offset;
+        allocation.block = block;
+    }
+
+    void MemoryAllocator::allocateDedicated(Allocation &allocation) {
+        std::byte *mapped;
+        allocation.kind = Allocation::Kind::DEDICATED;
+        allocation.memory = allocateMemory(allocation.memoryType, allocation.size, mapped);
+        allocation.mapped = mapped;
+
+        MemoryType &type = memoryTypes[allocation.memoryType];
+        type.dedicatedCount++;
+        type.dedicatedBytes += allocation.size;
+    }
+
+    void MemoryAllocator::bindBuffer(VkBuffer buffer, const Allocation &allocation) {
+        if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+            throw std::runtime_error("Failed to bind buffer memory!");
+    }
+
+    void MemoryAllocator::bindImage(VkImage image, const Allocation &allocation) {
+        if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+            throw std::runtime_error("Failed to bind image memory!");
+    }
+
+    VkMappedMemoryRange MemoryAllocator::getMappedRange(const Allocation &allocation,
+                                                        VkDeviceSize offset,
+                                                        VkDeviceSize size) const {
+        if (size == VK_WHOLE_SIZE) size = allocation.size - offset;
+
+        // The range has to be a multiple of nonCoherentAtomSize. Sub-allocations start and end on MIN_ALIGNMENT, which is
+        // at least as coarse, so growing the range never reaches into a neighbour
+        const VkDeviceSize begin = (allocation.offset + offset) & ~(nonCoherentAtomSize - 1);
+        const VkDeviceSize end = alignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.memory;
+        range.offset = begin;
+        range.size = allocation.kind == Allocation::Kind::DEDICATED && end > allocation.size ? VK_WHOLE_SIZE : end - begin;
+        return range;
+    }
+
+    VkResult MemoryAllocator::flush(const Allocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+        if (memoryProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+            return VK_SUCCESS;
+
+        const VkMappedMemoryRange range = getMappedRange(allocation, offset, size);
+        return vkFlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    VkResult MemoryAllocator::invalidate(const Allocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+        if (memoryProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+            return VK_SUCCESS;
+
+        const VkMappedMemoryRange range = getMappedRange(allocation, offset, size);
+        return vkInvalidateMappedMemoryRanges(device, 1, &range);
+    }
+
+    MemoryAllocator::Stats MemoryAllocator::getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        Stats stats{};
+        for (const auto &type : memoryTypes) {
+            for (const auto &blocks : type.blocks) {
+                for (const auto &block : blocks) {
+                    stats.blockCount++;
+                    stats.allocationCount += block->tlsf.getAllocationCount();
+                    stats.blockBytes += block->size;
+                    stats.usedBytes += block->tlsf.getUsedBytes();
+                    stats.freeBytes += block->tlsf.getFreeBytes();
+                    stats.largestFreeRange = std::max(stats.largestFreeRange, block->tlsf.getLargestFreeRange());
+                }
+            }
+
+            for (const auto &block : type.linearBlocks) {
+                stats.blockCount++;
+                stats.allocationCount += block->liveCount;
+                stats.blockBytes += block->size;
+                stats.usedBytes += block->head;
+                stats.freeBytes += block->size - block->head;
+                stats.largestFreeRange = std::max(stats.largestFreeRange, block->size - block->head);
+            }
+
+            stats.dedicatedCount += type.dedicatedCount;
+            stats.allocationCount += type.dedicatedCount;
+            stats.usedBytes += type.dedicatedBytes;
+        } return stats;
+    }
+
+    void MemoryAllocator::updateBudget() {
+        if (!memoryBudget) return;
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        for (uint32_t i = 0; i < heaps.size(); i++) {
+            heaps[i].budget = budgetProperties.heapBudget[i];
+            heaps[i].usage = budgetProperties.heapUsage[i];
+            heaps[i].allocatedBytesAtUpdate = heaps[i].allocatedBytes;
+        }
+    }
+
+    std::vector<MemoryAllocator::HeapBudget> MemoryAllocator::getBudget() const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        std::vector<HeapBudget> budget(heaps.size());
+        for (uint32_t i = 0; i < heaps.size(); i++) {
+            const Heap &heap = heaps[i];
+            budget[i].size = memoryProperties.memoryHeaps[i].size;
+            budget[i].budget = heap.budget;
+            budget[i].allocatedBytes = heap.allocatedBytes;
+            budget[i].usedBytes = heap.usedBytes;
+
+            // What the driver reported, plus or minus whatever was allocated and freed since
+            if (!memoryBudget) budget[i].usage = heap.allocatedBytes;
+            else if (heap.usage + heap.allocatedBytes > heap.allocatedBytesAtUpdate)
+                budget[i].usage = heap.usage + heap.allocatedBytes - heap.allocatedBytesAtUpdate;
+        } return budget;
+    }
+}
@@ -0,0 +1,232 @@
+#ifndef MEMORYALLOCATOR_HPP
+#define MEMORYALLOCATOR_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+namespace Engine {
+    // Two level segregated fit allocator over the offsets [0, size) of a memory block. Free ranges are binned by the
+    // position of their top bit, then by the next SL_BITS bits, so finding a fitting range, splitting and merging are
+    // all constant time. It doesn't touch Vulkan, MemoryAllocator maps the offsets onto a VkDeviceMemory.
+    class TlsfAllocator {
+    public:
+        static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+        // Offsets and sizes are multiples of this. It covers every offset alignment and the non coherent atom size the
+        // spec allows, so most requests never need padding
+        static constexpr VkDeviceSize MIN_ALIGNMENT = 256;
+
+        explicit TlsfAllocator(VkDeviceSize size);
+
+        // Returns the node of the allocated range, or INVALID_NODE if no free range is big enough.
+        // Alignment must be a power of two
+        uint32_t allocate(VkDeviceSize size, VkDeviceSize alignment);
+        void free(uint32_t node);
+
+        VkDeviceSize getOffset(uint32_t node) const { return nodes[node].offset; }
+        VkDeviceSize getSize(uint32_t node) const { return nodes[node].size; }
+
+        VkDeviceSize getUsedBytes() const { return usedBytes; }
+        VkDeviceSize getFreeBytes() const { return totalSize - usedBytes; }
+        VkDeviceSize getLargestFreeRange() const;
+        uint32_t getAllocationCount() const { return allocationCount; }
+        bool empty() const { return allocationCount == 0; }
+    private:
+        static constexpr uint32_t SL_BITS = 5;
+        static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+        static constexpr uint32_t FL_COUNT = 64;
+
+        struct Node {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+            uint32_t prevPhysical; // Neighbours in address order
+            uint32_t nextPhysical;
+            uint32_t prevFree; // Neighbours in the free list of its size class
+            uint32_t nextFree;
+            bool free;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> unusedNodes;
+
+        uint64_t flBitmap = 0;
+        std::array<uint32_t, FL_COUNT> slBitmaps{};
+        std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> freeHeads{};
+
+        VkDeviceSize totalSize;
+        VkDeviceSize usedBytes = 0;
+        uint32_t allocationCount = 0;
+
+        static void mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl);
+        uint32_t createNode(VkDeviceSize offset, VkDeviceSize size);
+        void insertFree(uint32_t node);
+        void removeFree(uint32_t node);
+        void merge(uint32_t node, uint32_t next); // Folds next into node, they must be physical neighbours
+    };
+
+    // Sub-allocates device memory out of large blocks, so buffers and images don't each need a vkAllocateMemory of
+    // their own (drivers cap the count, often at 4096, and the call is slow).
+    //
+    // Every memory type gets its own blocks, split between linear resources (buffers) and optimally tiled images, so
+    // neighbours never break bufferImageGranularity. Within a block, ranges come from a TlsfAllocator. Staging buffers
+    // live in separate linear pools: they are short lived and freed in bulk, so a block is just a bump pointer, rewound
+    // once everything in it is freed. Anything bigger than half a block gets a dedicated allocation.
+    //
+    // Host visible blocks are mapped once, for their whole lifetime, since a VkDeviceMemory can't be mapped twice.
+    //
+    // Memory is also accounted per heap, against the budget VK_EXT_memory_budget reports when the device has it. The
+    // driver only refreshes its numbers on updateBudget, in between, what this allocator did since is added on top.
+    class MemoryAllocator {
+    public:
+        static constexpr VkDeviceSize LARGE_HEAP_BLOCK_SIZE = 64 * 1024 * 1024;
+        static constexpr VkDeviceSize STAGING_BLOCK_SIZE = 32 * 1024 * 1024;
+        static constexpr VkDeviceSize SMALL_HEAP_SIZE = 1024 * 1024 * 1024; // Heaps up to this size get blocks of 1/8th
+        // Without VK_EXT_memory_budget, share of a heap assumed to be ours, the rest goes to other processes and the OS
+        static constexpr double DEFAULT_BUDGET_RATIO = 0.8;
+
+        enum class Usage {
+            DEFAULT,
+            STAGING // Written once by the CPU, copied from, and freed soon after
+        };
+
+        struct Allocation {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            void *mapped = nullptr; // Start of the allocation, when the memory is host visible
+            uint32_t memoryType = 0;
+
+            // Where it came from, to give it back
+            enum class Kind : uint8_t { NONE, BLOCK, LINEAR, DEDICATED } kind = Kind::NONE;
+            bool linearResource = true;
+            void *block = nullptr;
+            uint32_t node = TlsfAllocator::INVALID_NODE;
+        };
+
+        struct Stats {
+            uint32_t blockCount = 0; // Including the staging pools
+            uint32_t dedicatedCount = 0;
+            uint32_t allocationCount = 0; // Live sub-allocations and dedicated allocations
+            VkDeviceSize blockBytes = 0; // Device memory held by the blocks
+            VkDeviceSize usedBytes = 0; // Handed out, staging pools count everything below their head
+            VkDeviceSize freeBytes = 0; // Held by blocks but not handed out
+            VkDeviceSize largestFreeRange = 0;
+
+            // 0 when all the free memory of the blocks is one range, closer to 1 as it splits into smaller ones
+            float fragmentation() const {
+                return freeBytes == 0 ? 0.0f : 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes);
+            }
+            // vkAllocateMemory calls still alive, to compare against maxMemoryAllocationCount
+            uint32_t deviceAllocationCount() const { return blockCount + dedicatedCount; }
+        };
+
+        struct HeapBudget {
+            VkDeviceSize size = 0;
+            VkDeviceSize budget = 0; // What the process can use before allocations fail or start being paged out
+            VkDeviceSize usage = 0; // By the whole process, estimated from allocatedBytes without VK_EXT_memory_budget
+            VkDeviceSize allocatedBytes = 0; // Device memory held by this allocator, blocks and dedicated allocations
+            VkDeviceSize usedBytes = 0; // Handed out, the rest of allocatedBytes is free space in the blocks
+        };
+
+        // memoryBudget tells whether VK_EXT_memory_budget is enabled on the device
+        MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, bool memoryBudget);
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator &) = delete;
+        MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+        // linearResource is false for optimally tiled images. A memory type having the preferred properties on top of the
+        // required ones is picked if there's one, e.g. device local memory the CPU can also write to
+        Allocation allocate(const VkMemoryRequirements &requirements,
+                            VkMemoryPropertyFlags properties,
+                            Usage usage = Usage::DEFAULT,
+                            bool linearResource = true,
+                            VkMemoryPropertyFlags preferredProperties = 0);
+        void free(Allocation &allocation);
+        // Gives the empty blocks of a heap back to the driver, including the one free keeps to avoid thrashing, and
+        // returns how many bytes that was. Blocks still holding anything stay, however little
+        VkDeviceSize trim(uint32_t heap);
+
+        void bindBuffer(VkBuffer buffer, const Allocation &allocation);
+        void bindImage(VkImage image, const Allocation &allocation);
+
+        // Offsets are relative to the allocation, VK_WHOLE_SIZE goes to its end. No-ops for host coherent memory
+        VkResult flush(const Allocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        VkResult invalidate(const Allocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+        Stats getStats() const;
+
+        // Queries the driver for the current usage and budget of every heap, about once per frame is plenty
+        void updateBudget();
+        std::vector<HeapBudget> getBudget() const; // Indexed by heap
+        uint32_t getHeapIndex(uint32_t memoryType) const { return memoryProperties.memoryTypes[memoryType].heapIndex; }
+        bool hasMemoryBudget() const { return memoryBudget; }
+    private:
+        struct Block {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            std::byte *mapped = nullptr;
+            TlsfAllocator tlsf;
+
+            explicit Block(VkDeviceSize size) : size(size), tlsf(size) {}
+        };
+
+        struct LinearBlock {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            std::byte *mapped = nullptr;
+            VkDeviceSize head = 0; // Next free offset
+            uint32_t liveCount = 0;
+        };
+
+        struct MemoryType {
+            std::array<std::vector<std::unique_ptr<Block>>, 2> blocks; // Indexed by linearResource
+            std::vector<std::unique_ptr<LinearBlock>> linearBlocks;
+            uint32_t dedicatedCount = 0;
+            VkDeviceSize dedicatedBytes = 0;
+        };
+
+        struct Heap {
+            VkDeviceSize allocatedBytes = 0;
+            VkDeviceSize usedBytes = 0;
+            VkDeviceSize budget = 0;
+            VkDeviceSize usage = 0; // As of the last updateBudget
+            VkDeviceSize allocatedBytesAtUpdate = 0;
+        };
+
+        VkDevice device;
+        VkPhysicalDevice physicalDevice;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkDeviceSize nonCoherentAtomSize;
+        bool memoryBudget;
+        std::vector<MemoryType> memoryTypes;
+        std::vector<Heap> heaps;
+        mutable std::mutex mutex;
+
+        static constexpr uint32_t NO_MEMORY_TYPE = UINT32_MAX;
+        uint32_t findMemoryTypeOrNone(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+        VkDeviceSize getBlockSize(uint32_t memoryType) const;
+        bool isHostVisible(uint32_t memoryType) const;
+
+        // Allocates and, if host visible, maps a whole VkDeviceMemory
+        VkDeviceMemory allocateMemory(uint32_t memoryType, VkDeviceSize size, std::byte *&mapped);
+        void freeMemory(uint32_t memoryType, VkDeviceMemory memory, VkDeviceSize size, std::byte *mapped);
+
+        // Fill in allocation, whose memory type, size and resource kind are already set. They add a block when none fits
+        void allocateFromBlocks(VkDeviceSize blockSize, const VkMemoryRequirements &requirements, Allocation &allocation);
+        void allocateLinear(VkDeviceSize blockSize, const VkMemoryRequirements &requirements, Allocation &allocation);
+        void allocateDedicated(Allocation &allocation);
+
+        VkMappedMemoryRange getMappedRange(const Allocation &allocation, VkDeviceSize offset, VkDeviceSize size) const;
+    };
+}
+
+#endif
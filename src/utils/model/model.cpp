@@ -15,12 +15,31 @@ namespace std {
 }
 
 namespace Engine {
-    Model::Model(Device &device, const Model::Builder &builder) : device(device) {
-        createVertexBuffer(builder.vertices);
-        createIndexBuffer(builder.indices);
+    Model::Model(Device &device, const Model::Builder &builder) :
+        device(device), bounds(builder.bounds), vertices(builder.vertices), indices(builder.indices) {
+        assert((builder.vertices.empty() || bounds.sphere.w > 0.0f) && "Model bounds have not been computed!");
+        createVertexBuffer();
+        createIndexBuffer();
     }
     Model::~Model() = default;
 
+    void Model::evict() {
+        vertexBuffer.reset();
+        indexBuffer.reset();
+    }
+
+    UploadManager::Handle Model::restore() {
+        assert(!isResident() && "Model is already resident!");
+        uploadHandle = 0;
+        createVertexBuffer();
+        createIndexBuffer();
+        return uploadHandle;
+    }
+
+    VkDeviceSize Model::getMemorySize() const {
+        return vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t);
+    }
+
     void Model::Builder::loadModel(const std::string &path) {
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
@@ -79,6 +98,8 @@ namespace Engine {
                 indices.push_back(uniqueVertices[vertex]);
             }
         }
+
+        computeBounds();
     }
 
     std::unique_ptr<Model> Model::createModelFromFile(Device &device, const std::string &path) {
@@ -87,34 +108,39 @@ namespace Engine {
         return std::make_unique<Model>(device, builder);
     }
 
-    void Model::createVertexBuffer(const std::vector<Vertex> &vertices) {
+    Model::Bounds Model::Bounds::of(const std::vector<Vertex> &vertices) {
+        Bounds bounds{};
+        if (vertices.empty()) return bounds;
+
+        bounds.min = vertices[0].position;
+        bounds.max = vertices[0].position;
+        for (const auto &vertex : vertices) {
+            bounds.min = glm::min(bounds.min, vertex.position);
+            bounds.max = glm::max(bounds.max, vertex.position);
+        }
+
+        // Centered on the box, not the tightest sphere, but close enough for culling and cheap to get
+        const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        float radiusSquared = 0.0f;
+        for (const auto &vertex : vertices) {
+            const glm::vec3 offset = vertex.position - center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+
+        bounds.sphere = glm::vec4{center, std::sqrt(radiusSquared)};
+        return bounds;
+    }
+
+    void Model::createVertexBuffer() {
         vertexCount = static_cast<uint32_t>(vertices.size());
         assert(vertexCount >= 3 && "Vertex count must be of at least 3!");
 
         uint32_t vertexSize = sizeof(vertices[0]);
 
-        // For more information on staging buffers, see https://vulkan-tutorial.com/Vertex_buffers/Staging_buffer
-        Buffer stagingBuffer{
-            device,
-            vertexSize,
-            vertexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
-
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data());
-
-        vertexBuffer = std::make_unique<Buffer>(
-            device,
-            vertexSize,
-            vertexCount,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        device.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), vertexSize * vertexCount);
+        vertexBuffer = createStaticBuffer(vertexSize, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertices.data());
     }
 
-    void Model::createIndexBuffer(const std::vector<uint32_t> &indices) {
+    void Model::createIndexBuffer() {
         indexCount = static_cast<uint32_t>(indices.size());
         hasIndexBuffer = indexCount > 0;
         if(!hasIndexBuffer) return;
@@ -122,25 +148,34 @@ namespace Engine {
 
         uint32_t indexSize = sizeof(indices[0]);
 
-        // For more information on staging buffers, see https://vulkan-tutorial.com/Vertex_buffers/Staging_buffer
-        Buffer stagingBuffer{
-                device,
-                indexSize,
-                indexCount,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
-
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
+        indexBuffer = createStaticBuffer(indexSize, indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indices.data());
+    }
 
-        indexBuffer = std::make_unique<Buffer>(
+    std::unique_ptr<Buffer> Model::createStaticBuffer(VkDeviceSize instanceSize,
+                                                      uint32_t instanceCount,
+                                                      VkBufferUsageFlags usageFlags,
+                                                      const void *data) {
+        const bool small = instanceSize * instanceCount <= DIRECT_WRITE_THRESHOLD;
+        auto buffer = std::make_unique<Buffer>(
                 device,
-                indexSize,
-                indexCount,
-                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        device.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), indexSize * indexCount);
+                instanceSize,
+                instanceCount,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | usageFlags,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                1,
+                small ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : 0);
+
+        // Once flushed, host writes are visible to every later submission, no barrier or queue ownership transfer
+        // needed. The flush only matters for non coherent memory, which the bigger buffers can end up in on UMA devices
+        if (buffer->isHostVisible()) {
+            buffer->map();
+            buffer->writeToBuffer(const_cast<void *>(data));
+            buffer->flush();
+            buffer->unmap();
+        } else {
+            // Handles grow with every batch, and batches complete in order, so the last one covers both buffers
+            uploadHandle = device.getUploadManager().uploadBuffer(buffer->getBuffer(), data, buffer->getBufferSize());
+        } return buffer;
     }
 
     void Model::bind(VkCommandBuffer commandBuffer) {
@@ -149,9 +184,40 @@ namespace Engine {
         vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
         if(hasIndexBuffer) vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
     }
-    void Model::draw(VkCommandBuffer commandBuffer) const {
-        if(hasIndexBuffer) vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
-        else vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    void Model::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) const {
+        if(hasIndexBuffer) vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
+        else vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance);
+    }
+
+    void Model::writeIndirectCommand(void *command, uint32_t instanceCount, uint32_t firstInstance) const {
+        if (hasIndexBuffer) {
+            VkDrawIndexedIndirectCommand indexed{indexCount, instanceCount, 0, 0, firstInstance};
+            std::memcpy(command, &indexed, sizeof(indexed));
+        } else {
+            VkDrawIndirectCommand plain{vertexCount, instanceCount, 0, firstInstance};
+            std::memcpy(command, &plain, sizeof(plain));
+        }
+    }
+    void Model::drawIndirectCount(VkCommandBuffer commandBuffer,
+                                  VkBuffer drawBuffer,
+                                  VkDeviceSize drawOffset,
+                                  VkBuffer countBuffer,
+                                  VkDeviceSize countOffset,
+                                  uint32_t maxDrawCount) const {
+        if (hasIndexBuffer) vkCmdDrawIndexedIndirectCount(commandBuffer,
+                                                          drawBuffer,
+                                                          drawOffset,
+                                                          countBuffer,
+                                                          countOffset,
+                                                          maxDrawCount,
+                                                          INDIRECT_COMMAND_STRIDE);
+        else vkCmdDrawIndirectCount(commandBuffer,
+                                    drawBuffer,
+                                    drawOffset,
+                                    countBuffer,
+                                    countOffset,
+                                    maxDrawCount,
+                                    INDIRECT_COMMAND_STRIDE);
     }
 
     std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
@@ -14,6 +14,7 @@
 #include "../utils.hpp"
 #include "../device/device.hpp"
 #include "../buffer/buffer.hpp"
+#include "../upload/uploadmanager.hpp"
 
 // TODO(Dory): Add support for importing .stl and .3mf files
 // This are the ones I care about, rest can be added later, or never, I don't care, LULZ
@@ -41,11 +42,22 @@ namespace Engine {
             }
         };
 
+        // Model space bounding volumes, used for culling
+        struct Bounds {
+            glm::vec3 min{0.0f};
+            glm::vec3 max{0.0f};
+            glm::vec4 sphere{0.0f}; // Center (xyz) and radius (w)
+
+            static Bounds of(const std::vector<Vertex> &vertices);
+        };
+
         struct Builder {
             std::vector<Vertex> vertices{};
             std::vector<uint32_t> indices{};
+            Bounds bounds{}; // Filled by loadModel, call computeBounds when filling the vertices by hand
 
             void loadModel(const std::string &path);
+            void computeBounds() { bounds = Bounds::of(vertices); }
         };
 
         Model(Device &device, const Model::Builder &builder);
@@ -57,9 +69,42 @@ namespace Engine {
         static std::unique_ptr<Model> createModelFromFile(Device &device, const std::string &path);
 
         void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer) const;
+        // Instances are told apart in the shaders through gl_InstanceIndex, which starts at firstInstance
+        void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+
+        // Indirect draws are INDIRECT_COMMAND_STRIDE bytes apart, a VkDrawIndexedIndirectCommand for indexed models and a
+        // VkDrawIndirectCommand otherwise. Either way instanceCount is the second word, so the GPU can bump it blindly.
+        static constexpr uint32_t INDIRECT_COMMAND_STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+        void writeIndirectCommand(void *command, uint32_t instanceCount, uint32_t firstInstance) const;
+        // Runs the draws at drawOffset, as many as the GPU wrote to countBuffer at countOffset (up to maxDrawCount)
+        void drawIndirectCount(VkCommandBuffer commandBuffer,
+                               VkBuffer drawBuffer,
+                               VkDeviceSize drawOffset,
+                               VkBuffer countBuffer,
+                               VkDeviceSize countOffset,
+                               uint32_t maxDrawCount) const;
+
+        const Bounds &getBounds() const { return bounds; }
+        // Center (xyz) and radius (w) of a sphere enclosing every vertex, in model space
+        glm::vec4 getBoundingSphere() const { return bounds.sphere; }
+
+        // Residency, see ResidencyManager. Evicting frees the vertex and index buffers, the GPU must be done with them.
+        // restore recreates them from the copy of the builder data kept in system memory, and returns the handle of
+        // the upload, the model mustn't be drawn before it completes (0 when it was written in place).
+        bool isResident() const { return vertexBuffer != nullptr; }
+        void evict();
+        UploadManager::Handle restore();
+        UploadManager::Handle getUploadHandle() const { return uploadHandle; }
+        VkDeviceSize getMemorySize() const;
+        uint32_t getMemoryType() const { return vertexBuffer->getMemoryType(); }
     private:
-        Device device;
+        // Buffers up to this size prefer device local memory the CPU can also write to (integrated GPUs, resizable
+        // BAR), and are filled in place instead of through a staging copy. Bigger ones don't ask for it, that memory can
+        // be as small as 256 MiB and is better kept for per-frame data, so they go through the upload manager unless
+        // all device local memory is host visible anyway (integrated GPUs), then they are filled in place too
+        static constexpr VkDeviceSize DIRECT_WRITE_THRESHOLD = 4 * 1024 * 1024;
+
+        Device &device;
 
         std::unique_ptr<Buffer> vertexBuffer;
         uint32_t vertexCount;
@@ -68,8 +113,18 @@ namespace Engine {
         std::unique_ptr<Buffer> indexBuffer;
         uint32_t indexCount;
 
-        void createVertexBuffer(const std::vector<Vertex> &vertices);
-        void createIndexBuffer(const std::vector<uint32_t> &indices);
+        Bounds bounds;
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        UploadManager::Handle uploadHandle = 0;
+
+        void createVertexBuffer();
+        void createIndexBuffer();
+        std::unique_ptr<Buffer> createStaticBuffer(VkDeviceSize instanceSize,
+                                                   uint32_t instanceCount,
+                                                   VkBufferUsageFlags usageFlags,
+                                                   const void *data);
     };
 }
 
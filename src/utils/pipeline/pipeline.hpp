@@ -59,6 +59,24 @@ namespace Engine {
                                     const PipelineConfigInfo& configInfo);
 
         void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+
+        friend class ComputePipeline;
+    };
+
+    class ComputePipeline {
+    public:
+        ComputePipeline(Device &device, const std::string &compFilepath, VkPipelineLayout pipelineLayout);
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline&) = delete;
+        ComputePipeline &operator=(const ComputePipeline&) = delete;
+
+        void bind(VkCommandBuffer commandBuffer);
+
+    private:
+        Device& device;
+        VkPipeline computePipeline;
+        VkShaderModule compShaderModule;
     };
 }
 
@@ -423,5 +423,6 @@ namespace Engine::Procedural {
         }
 
         builder = *new Model::Builder{vertices, indices};
+        builder.computeBounds();
     }
 }
\ No newline at end of file
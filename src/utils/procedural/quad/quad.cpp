@@ -93,5 +93,6 @@ namespace Engine::Procedural {
         }
 
         builder = *new Model::Builder{vertices, indices};
+        builder.computeBounds();
     }
 }
\ No newline at end of file
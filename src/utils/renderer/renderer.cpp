@@ -1,5 +1,7 @@
 #include "renderer.hpp"
 
+#include <algorithm>
+
 // TODO(Dory): Add error codes TO ALL CODE to make debugging easier and faster
 // That is gonna take a looong time...
 namespace Engine {
@@ -8,6 +10,7 @@ namespace Engine {
         createCommandBuffers();
     }
     Renderer::~Renderer() {
+        destroySecondaryPools();
         freeCommandBuffers();
     }
 
@@ -24,6 +27,7 @@ namespace Engine {
             throw std::runtime_error("Failed to acquire swap chain image!");
 
         isFrameStarted = true;
+        resetSecondaryPools(currentFrameIndex); // acquireNextImage waited for the GPU to be done with this frame
 
         auto commandBuffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo beginInfo{};
@@ -50,7 +54,7 @@ namespace Engine {
         currentFrameIndex = (currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
-    void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+    void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents) {
         assert(isFrameStarted && "Cannot begin the render pass outside of a frame!");
         assert(commandBuffer == getCurrentCommandBuffer() && "Cannot start the render pass on a command buffer from another frame!");
 
@@ -68,8 +72,12 @@ namespace Engine {
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
 
+        // Secondary command buffers don't inherit dynamic state, they set their own (see beginSecondaryCommandBuffer)
+        if (contents == VK_SUBPASS_CONTENTS_INLINE) setViewportAndScissor(commandBuffer);
+    }
+    void Renderer::setViewportAndScissor(VkCommandBuffer commandBuffer) const {
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
@@ -88,6 +96,93 @@ namespace Engine {
         vkCmdEndRenderPass(commandBuffer);
     }
 
+    void Renderer::recordSecondary(VkCommandBuffer commandBuffer,
+                                   ThreadPool &threadPool,
+                                   size_t count,
+                                   size_t minSliceSize,
+                                   const std::function<void(VkCommandBuffer, size_t, size_t)> &record) {
+        assert(isFrameStarted && "Cannot record secondary command buffers outside of a frame!");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Cannot record secondary command buffers for another frame!");
+        if (count == 0) return;
+
+        // At most one slice per thread that can record, the calling one included
+        minSliceSize = std::max<size_t>(minSliceSize, 1);
+        const size_t sliceCount = std::min<size_t>(threadPool.getThreadCount() + 1, (count + minSliceSize - 1) / minSliceSize);
+        const size_t sliceSize = (count + sliceCount - 1) / sliceCount;
+
+        // Pools are created up front, on this thread, the workers only ever touch their own
+        auto &pools = secondaryPools[currentFrameIndex];
+        while (pools.size() < sliceCount) {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+            SecondaryPool &pool = pools.emplace_back();
+            if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create secondary command pool!");
+        }
+
+        std::vector<VkCommandBuffer> secondaryBuffers(sliceCount);
+        threadPool.parallelFor(sliceCount, 1, [&](size_t firstSlice, size_t lastSlice) {
+            for (size_t slice = firstSlice; slice < lastSlice; slice++) {
+                VkCommandBuffer secondary = beginSecondaryCommandBuffer(pools[slice]);
+                record(secondary, slice * sliceSize, std::min(count, (slice + 1) * sliceSize));
+                if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to record secondary command buffer!");
+                secondaryBuffers[slice] = secondary;
+            }
+        });
+
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+    }
+
+    VkCommandBuffer Renderer::beginSecondaryCommandBuffer(SecondaryPool &pool) {
+        if (pool.usedCount == pool.commandBuffers.size()) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandPool = pool.commandPool;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer newBuffer;
+            if (vkAllocateCommandBuffers(device.device(), &allocInfo, &newBuffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate secondary command buffer!");
+            pool.commandBuffers.push_back(newBuffer);
+        }
+        VkCommandBuffer commandBuffer = pool.commandBuffers[pool.usedCount++];
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = swapChain->getRenderPass();
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = swapChain->getFrameBuffer(static_cast<int>(currentImageIndex));
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin recording secondary command buffer!");
+
+        setViewportAndScissor(commandBuffer);
+        return commandBuffer;
+    }
+
+    void Renderer::resetSecondaryPools(uint32_t frameIndex) {
+        for (auto &pool : secondaryPools[frameIndex]) {
+            vkResetCommandPool(device.device(), pool.commandPool, 0);
+            pool.usedCount = 0;
+        }
+    }
+
+    void Renderer::destroySecondaryPools() {
+        for (auto &pools : secondaryPools) {
+            for (auto &pool : pools) vkDestroyCommandPool(device.device(), pool.commandPool, nullptr); // Frees the buffers too
+            pools.clear();
+        }
+    }
+
     void Renderer::createCommandBuffers() {
             commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
 
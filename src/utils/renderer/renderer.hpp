@@ -5,10 +5,12 @@
 #include <vector>
 #include <array>
 #include <cassert>
+#include <functional>
 
 #include "../window/window.hpp"
 #include "../device/device.hpp"
 #include "../swapchain/swapchain.hpp"
+#include "../jobs/threadpool.hpp"
 
 namespace Engine {
     class Renderer {
@@ -35,16 +37,38 @@ namespace Engine {
         VkCommandBuffer beginFrame();
         void endFrame();
 
-        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, everything drawn in the pass has to go through recordSecondary
+        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer,
+                                      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+
+        // Splits [0, count) in slices of at least minSliceSize elements, records each slice into its own secondary
+        // command buffer across the thread pool with record(secondaryCommandBuffer, begin, end), then executes them in
+        // order in commandBuffer. Every slice allocates from a command pool owned by that slice and frame, so no pool is
+        // ever used by two threads at once. The secondary buffers inherit the swap chain render pass and have the viewport
+        // and scissor already set.
+        void recordSecondary(VkCommandBuffer commandBuffer,
+                             ThreadPool &threadPool,
+                             size_t count,
+                             size_t minSliceSize,
+                             const std::function<void(VkCommandBuffer, size_t, size_t)> &record);
 
         float getAspectRatio() const { return swapChain->extentAspectRatio(); }
+        VkExtent2D getSwapChainExtent() const { return swapChain->getSwapChainExtent(); }
 
         void endSwapChainRenderPass(VkCommandBuffer commandBuffer) const;
     private:
+        // Secondary command buffers of one slice, recycled every time their frame comes around
+        struct SecondaryPool {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> commandBuffers;
+            uint32_t usedCount = 0;
+        };
+
         Window &window;
         Device &device;
         std::unique_ptr<SwapChain> swapChain;
         std::vector<VkCommandBuffer> commandBuffers;
+        std::array<std::vector<SecondaryPool>, SwapChain::MAX_FRAMES_IN_FLIGHT> secondaryPools; // Per frame, per slice
 
         uint32_t currentImageIndex = 0;
         uint32_t currentFrameIndex = 0;
@@ -53,6 +77,11 @@ namespace Engine {
         void createCommandBuffers();
         void freeCommandBuffers();
         void recreateSwapChain();
+
+        void setViewportAndScissor(VkCommandBuffer commandBuffer) const;
+        void resetSecondaryPools(uint32_t frameIndex);
+        void destroySecondaryPools();
+        VkCommandBuffer beginSecondaryCommandBuffer(SecondaryPool &pool);
     };
 }
 
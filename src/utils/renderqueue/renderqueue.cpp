@@ -0,0 +1,49 @@
+#include "renderqueue.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace Engine {
+    uint64_t RenderQueue::makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+        // The bits of a positive float sort the same way as its value, so its top bits make a depth that needs no range
+        const float clampedDepth = depth > 0.0f ? depth : 0.0f;
+        uint32_t depthBits;
+        std::memcpy(&depthBits, &clampedDepth, sizeof(depthBits));
+        depthBits >>= 32 - DEPTH_BITS;
+
+        auto mask = [](uint32_t value, uint32_t bits) { return static_cast<uint64_t>(value) & ((uint64_t{1} << bits) - 1); };
+        return mask(pass, PASS_BITS) << PASS_SHIFT |
+               mask(pipeline, PIPELINE_BITS) << PIPELINE_SHIFT |
+               mask(material, MATERIAL_BITS) << MATERIAL_SHIFT |
+               mask(mesh, MESH_BITS) << MESH_SHIFT |
+               mask(depthBits, DEPTH_BITS) << DEPTH_SHIFT;
+    }
+
+    void RenderQueue::sort() {
+        constexpr size_t RADIX = 256;
+        constexpr size_t DIGITS = sizeof(uint64_t);
+        if (packets.size() < 2) return;
+
+        // Histograms of every byte in a single sweep
+        std::array<std::array<uint32_t, RADIX>, DIGITS> counts{};
+        for (const Packet &packet : packets)
+            for (size_t digit = 0; digit < DIGITS; digit++) counts[digit][(packet.key >> (digit * 8)) & 0xFF]++;
+
+        scratch.resize(packets.size());
+        for (size_t digit = 0; digit < DIGITS; digit++) {
+            // Every key has the same byte here (the pass and pipeline usually do), nothing would move
+            const size_t firstByte = (packets.front().key >> (digit * 8)) & 0xFF;
+            if (counts[digit][firstByte] == packets.size()) continue;
+
+            std::array<uint32_t, RADIX> offsets{};
+            uint32_t offset = 0;
+            for (size_t bucket = 0; bucket < RADIX; bucket++) {
+                offsets[bucket] = offset;
+                offset += counts[digit][bucket];
+            }
+
+            for (const Packet &packet : packets) scratch[offsets[(packet.key >> (digit * 8)) & 0xFF]++] = packet;
+            packets.swap(scratch);
+        }
+    }
+}
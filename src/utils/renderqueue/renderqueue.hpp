@@ -0,0 +1,70 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Engine {
+    // Draw packets sorted by a packed 64 bit key, so draws sharing state end up next to each other and the renderer only
+    // has to rebind what changed between two consecutive packets. From the most to the least significant bits:
+    //
+    //   pass (4) | pipeline (8) | material (12) | mesh (16) | depth (24)
+    //
+    // Depth comes last so that within the same state, draws go front to back and early depth testing rejects as much as
+    // possible. Sorting is an LSD radix sort, a byte per pass, skipping the bytes every key has in common.
+    class RenderQueue {
+    public:
+        static constexpr uint32_t PASS_BITS = 4;
+        static constexpr uint32_t PIPELINE_BITS = 8;
+        static constexpr uint32_t MATERIAL_BITS = 12;
+        static constexpr uint32_t MESH_BITS = 16;
+        static constexpr uint32_t DEPTH_BITS = 24;
+
+        static constexpr uint32_t DEPTH_SHIFT = 0;
+        static constexpr uint32_t MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+        static constexpr uint32_t MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+        static constexpr uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+        static constexpr uint32_t PASS_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+        static_assert(PASS_SHIFT + PASS_BITS == 64, "Draw key fields have to fill exactly 64 bits!");
+
+        static constexpr uint32_t MAX_MESHES = 1u << MESH_BITS;
+
+        struct Packet {
+            uint64_t key;
+            uint32_t index; // Whatever the submitting system needs to find the draw again, usually into its own arrays
+        };
+
+        // Fields wider than their bits are truncated, depth is the view space distance (negative values count as 0)
+        static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+        static uint32_t getPass(uint64_t key) { return field(key, PASS_SHIFT, PASS_BITS); }
+        static uint32_t getPipeline(uint64_t key) { return field(key, PIPELINE_SHIFT, PIPELINE_BITS); }
+        static uint32_t getMaterial(uint64_t key) { return field(key, MATERIAL_SHIFT, MATERIAL_BITS); }
+        static uint32_t getMesh(uint64_t key) { return field(key, MESH_SHIFT, MESH_BITS); }
+
+        // Whether two keys only differ by their depth, meaning nothing has to be rebound between them
+        static bool sameState(uint64_t a, uint64_t b) { return (a >> MESH_SHIFT) == (b >> MESH_SHIFT); }
+
+        void clear() { packets.clear(); }
+        void reserve(size_t count) { packets.reserve(count); }
+        void submit(uint64_t key, uint32_t index) { packets.push_back({key, index}); }
+
+        // Stable, packets with equal keys keep their submission order
+        void sort();
+
+        size_t size() const { return packets.size(); }
+        bool empty() const { return packets.empty(); }
+        std::span<const Packet> getPackets() const { return packets; }
+    private:
+        std::vector<Packet> packets;
+        std::vector<Packet> scratch; // Radix sort ping pong buffer, kept around so it doesn't get reallocated every frame
+
+        static uint32_t field(uint64_t key, uint32_t shift, uint32_t bits) {
+            return static_cast<uint32_t>((key >> shift) & ((uint64_t{1} << bits) - 1));
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include "residencymanager.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../swapchain/swapchain.hpp"
+
+namespace Engine {
+    ResidencyManager::ResidencyManager(Device &device, TextureTable &textureTable) :
+        device(device), textureTable(textureTable) {}
+
+    template<typename Resource>
+    bool ResidencyManager::request(Entry &entry, const Resource &resource) {
+        entry.lastUsedFrame = frameNumber;
+        if (!resource.isResident()) {
+            entry.requested = true;
+            return false;
+        }
+
+        if (entry.pending == 0) return true;
+        if (!device.getUploadManager().isComplete(entry.pending)) return false;
+        entry.pending = 0;
+        return true;
+    }
+
+    bool ResidencyManager::requestModel(const std::shared_ptr<Model> &model) {
+        assert(model && "Cannot request a null model!");
+        auto [it, inserted] = models.try_emplace(model.get());
+        ModelEntry &entry = it->second;
+        if (inserted || entry.model.expired()) { // Or a new model where a dead one used to be
+            entry.model = model;
+            entry.pending = model->getUploadHandle();
+        } return request(entry, *model);
+    }
+
+    bool ResidencyManager::requestTexture(uint32_t textureIndex) {
+        assert(textureIndex < textureTable.size() && "Texture index out of range!");
+        if (textureIndex >= textures.size()) return false; // Registered since the last update, tracked from the next
+        return request(textures[textureIndex], textureTable.get(textureIndex));
+    }
+
+    void ResidencyManager::update() {
+        frameNumber++;
+
+        // Models nobody refers to anymore took their memory with them
+        std::erase_if(models, [](const auto &model) { return model.second.model.expired(); });
+
+        // Textures registered since the last update start out with the upload that created them
+        while (textures.size() < textureTable.size()) {
+            const auto index = static_cast<uint32_t>(textures.size());
+            TextureEntry &entry = textures.emplace_back();
+            entry.lastUsedFrame = frameNumber;
+            entry.pending = textureTable.get(index).getUploadHandle();
+        }
+
+        restoreRequested(); // Before the budgets are read, so the eviction below accounts for it
+
+        MemoryAllocator &allocator = device.getAllocator();
+        allocator.updateBudget();
+        stats.heaps = allocator.getBudget();
+
+        // Freed allocations only count once their whole block went back to the driver
+        std::vector<VkDeviceSize> excess(stats.heaps.size(), 0);
+        bool trimmed = false, overBudget = false;
+        for (uint32_t i = 0; i < stats.heaps.size(); i++) {
+            const MemoryAllocator::HeapBudget &heap = stats.heaps[i];
+            const auto limit = static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * EVICTION_THRESHOLD);
+            if (heap.usage <= limit) continue;
+
+            trimmed = true;
+            const VkDeviceSize released = allocator.trim(i);
+            stats.releasedBytes += released;
+            if (heap.usage - released <= limit) continue;
+
+            excess[i] = heap.usage - released - limit;
+            overBudget = true;
+        }
+        if (overBudget) evictOverBudget(excess);
+        if (trimmed) stats.heaps = allocator.getBudget(); // As eviction left them
+
+        stats.residentCount = 0;
+        stats.evictedCount = 0;
+        for (const auto &[model, entry] : models) (model->isResident() ? stats.residentCount : stats.evictedCount)++;
+        for (uint32_t i = 0; i < textures.size(); i++)
+            (textureTable.get(i).isResident() ? stats.residentCount : stats.evictedCount)++;
+    }
+
+    void ResidencyManager::restoreRequested() {
+        for (auto &[key, entry] : models) {
+            if (!entry.requested) continue;
+            entry.requested = false;
+
+            const std::shared_ptr<Model> model = entry.model.lock();
+            if (!model || model->isResident()) continue;
+            entry.pending = model->restore();
+            stats.restoreCount++;
+            stats.restoredBytes += model->getMemorySize();
+        }
+
+        // Textures first read their file on another thread, and are restored by the first update after it's done
+        for (uint32_t i = 0; i < textures.size(); i++) {
+            TextureEntry &entry = textures[i];
+            Texture &texture = textureTable.get(i);
+            if (entry.requested && !entry.loading.valid() && !texture.isResident())
+                entry.loading = std::async(std::launch::async, [&texture] { return texture.loadPixels(); });
+            entry.requested = false;
+
+            if (!entry.loading.valid() || entry.loading.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+                continue;
+            entry.pending = texture.restore(entry.loading.get()); // Rethrows if the file couldn't be loaded
+            textureTable.refresh(i); // New view, nothing samples it before the upload is done
+            stats.restoreCount++;
+            stats.restoredBytes += texture.getMemorySize();
+        }
+    }
+
+    // Frame N is done once Renderer::beginFrame of frame N + MAX_FRAMES_IN_FLIGHT waited for its fence
+    bool ResidencyManager::isEvictable(const Entry &entry) const {
+        if (entry.lastUsedFrame + SwapChain::MAX_FRAMES_IN_FLIGHT > frameNumber) return false;
+        return entry.pending == 0 || device.getUploadManager().isComplete(entry.pending);
+    }
+
+    void ResidencyManager::evictOverBudget(std::vector<VkDeviceSize> &excess) {
+        MemoryAllocator &allocator = device.getAllocator();
+
+        candidates.clear();
+        for (auto &[key, entry] : models) {
+            const std::shared_ptr<Model> model = entry.model.lock();
+            if (!model || !model->isResident() || !isEvictable(entry)) continue;
+
+            const uint32_t heap = allocator.getHeapIndex(model->getMemoryType());
+            if (excess[heap] == 0) continue;
+            candidates.push_back({entry.lastUsedFrame, model.get(), 0, heap, model->getMemorySize()});
+        }
+        for (uint32_t i = 0; i < textures.size(); i++) {
+            Texture &texture = textureTable.get(i);
+            if (!texture.isResident() || !isEvictable(textures[i])) continue;
+
+            const uint32_t heap = allocator.getHeapIndex(texture.getMemoryType());
+            if (excess[heap] == 0) continue;
+            candidates.push_back({textures[i].lastUsedFrame, nullptr, i, heap, texture.getMemorySize()});
+        }
+
+        // Least recently drawn first, until every heap is back under its threshold. Only what the driver got back
+        // counts, the freed range of a block something else still lives in is reused, but not returned
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+            return a.lastUsedFrame < b.lastUsedFrame;
+        });
+        for (const Candidate &candidate : candidates) {
+            if (excess[candidate.heap] == 0) continue;
+
+            if (candidate.model) candidate.model->evict();
+            else textureTable.get(candidate.textureIndex).evict();
+            stats.evictionCount++;
+            stats.evictedBytes += candidate.size;
+
+            const VkDeviceSize released = allocator.trim(candidate.heap);
+            excess[candidate.heap] -= std::min(excess[candidate.heap], released);
+            stats.releasedBytes += released;
+        }
+    }
+}
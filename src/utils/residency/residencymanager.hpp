@@ -0,0 +1,102 @@
+#ifndef RESIDENCYMANAGER_HPP
+#define RESIDENCYMANAGER_HPP
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hpp"
+#include "../model/model.hpp"
+#include "../texture/texturetable.hpp"
+#include "../upload/uploadmanager.hpp"
+
+namespace Engine {
+    // Keeps the GPU memory of models and textures within the budget of their heap.
+    // Render systems request every model and texture they are about to draw, which stamps it with the current frame,
+    // and queues it to be brought back if it was evicted. It can only be drawn once that upload completes.
+    // Once per frame, update restores what was queued and refreshes the heap budgets (see MemoryAllocator::getBudget).
+    // A heap over EVICTION_THRESHOLD of its budget first gives its empty blocks back, then the least recently drawn
+    // models and textures living there are evicted until enough blocks emptied to bring the usage the driver sees back
+    // under. Only what no frame in flight uses is evicted, and never anything still being uploaded.
+    //
+    // Models keep a copy of their vertices and indices in system memory to be rebuilt, textures are loaded from
+    // their file again, on a thread of their own so reading and decoding it never holds up a frame. Models nobody
+    // draws never get tracked, so they are never evicted.
+    // update runs on the main thread between frames. Requests only touch their entry, so they can come from a
+    // system on a worker thread, as long as one thread at a time requests and never while update runs.
+    class ResidencyManager {
+    public:
+        // Share of a heap's budget eviction keeps the usage under, the rest is headroom for new allocations
+        static constexpr double EVICTION_THRESHOLD = 0.9;
+
+        struct Stats {
+            std::vector<MemoryAllocator::HeapBudget> heaps; // As of the last update, indexed by heap
+            uint32_t residentCount = 0; // Tracked models and textures in device memory, pending uploads included
+            uint32_t evictedCount = 0; // Tracked models and textures currently evicted
+            uint64_t evictionCount = 0; // Since startup
+            uint64_t restoreCount = 0;
+            VkDeviceSize evictedBytes = 0; // Size of the evicted allocations
+            VkDeviceSize releasedBytes = 0; // Device memory freed as blocks emptied, what the driver actually got back
+            VkDeviceSize restoredBytes = 0;
+        };
+
+        ResidencyManager(Device &device, TextureTable &textureTable);
+
+        ResidencyManager(const ResidencyManager &) = delete;
+        ResidencyManager& operator=(const ResidencyManager &) = delete;
+
+        // Marks it as drawn this frame, queuing a restore if it was evicted. Returns whether it can be drawn right now.
+        bool requestModel(const std::shared_ptr<Model> &model);
+        bool requestTexture(uint32_t textureIndex);
+
+        // Once per frame on the main thread, after Renderer::beginFrame waited for the frame's fence and before
+        // anything is requested
+        void update();
+
+        const Stats &getStats() const { return stats; }
+    private:
+        struct Entry {
+            uint64_t lastUsedFrame = 0;
+            UploadManager::Handle pending = 0; // Upload bringing it in, until it completes
+            bool requested = false; // Drawn while evicted, the next update restores it
+        };
+
+        struct ModelEntry : Entry {
+            std::weak_ptr<Model> model;
+        };
+
+        struct TextureEntry : Entry {
+            std::future<Texture::Pixels> loading; // File being read again, restored once it's ready
+        };
+
+        // Something evictable from an over budget heap
+        struct Candidate {
+            uint64_t lastUsedFrame;
+            Model *model; // Either a model,
+            uint32_t textureIndex; // or a texture when model is null
+            uint32_t heap;
+            VkDeviceSize size;
+        };
+
+        Device &device;
+        TextureTable &textureTable;
+        uint64_t frameNumber = 0;
+
+        std::unordered_map<const Model*, ModelEntry> models;
+        std::vector<TextureEntry> textures; // Indexed like the texture table
+        std::vector<Candidate> candidates;
+        Stats stats{};
+
+        template<typename Resource>
+        bool request(Entry &entry, const Resource &resource);
+        bool isEvictable(const Entry &entry) const;
+        void restoreRequested();
+        void evictOverBudget(std::vector<VkDeviceSize> &excess);
+    };
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "mappedfile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Engine {
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::string &filepath) {
+        file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open file: " + filepath);
+
+        LARGE_INTEGER fileSize{};
+        GetFileSizeEx(file, &fileSize);
+        mappedSize = static_cast<size_t>(fileSize.QuadPart);
+        if (mappedSize == 0) return;
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) mapped = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!mapped) {
+            if (mapping) CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("Failed to map file: " + filepath);
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        if (mapped) UnmapViewOfFile(mapped);
+        if (mapping) CloseHandle(mapping);
+        if (file && file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    }
+#else
+    MappedFile::MappedFile(const std::string &filepath) {
+        int fd = open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Failed to open file: " + filepath);
+
+        struct stat info{};
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to read the size of file: " + filepath);
+        }
+
+        mappedSize = static_cast<size_t>(info.st_size);
+        if (mappedSize > 0) {
+            void *address = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Failed to map file: " + filepath);
+            }
+
+            madvise(address, mappedSize, MADV_WILLNEED); // Everything is going to be read right away
+            mapped = static_cast<const std::byte*>(address);
+        } close(fd); // The mapping keeps the file alive on its own
+    }
+
+    MappedFile::~MappedFile() {
+        if (mapped) munmap(const_cast<std::byte*>(mapped), mappedSize);
+    }
+#endif
+}
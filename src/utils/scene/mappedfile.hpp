@@ -0,0 +1,29 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace Engine {
+    // Read-only memory mapping of a whole file, unmapped on destruction
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string &filepath);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const std::byte *data() const { return mapped; }
+        size_t size() const { return mappedSize; }
+    private:
+        const std::byte *mapped = nullptr;
+        size_t mappedSize = 0;
+#ifdef _WIN32
+        void *file = nullptr;
+        void *mapping = nullptr;
+#endif
+    };
+}
+
+#endif
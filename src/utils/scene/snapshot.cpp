@@ -0,0 +1,310 @@
+#include "snapshot.hpp"
+#include "mappedfile.hpp"
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace Engine::SceneSnapshot {
+    // File layout, every section starts on a SECTION_ALIGNMENT boundary:
+    // FileHeader | ArchetypeHeader[archetypeCount] | asset table | per archetype: ids, then one array per component
+    constexpr std::array<char, 4> MAGIC{'D', 'S', 'C', 'N'};
+    constexpr size_t SECTION_ALIGNMENT = 16;
+    constexpr uint32_t NO_ASSET = UINT32_MAX;
+
+    struct FileHeader {
+        std::array<char, 4> magic;
+        uint32_t version;
+        uint32_t entityCount;
+        uint32_t archetypeCount;
+        uint32_t assetCount;
+        uint32_t reserved;
+        uint64_t assetTableOffset; // Each asset is a uint32_t length followed by its name, padded to 4 bytes
+        uint64_t fileSize;
+    };
+
+    struct ArchetypeHeader {
+        uint32_t mask;
+        uint32_t count;
+        uint64_t idsOffset; // Entity::id_t[count], as they were when written
+        std::array<uint64_t, MAX_COMPONENT_TYPES> columnOffsets; // Only for the components in the mask
+    };
+
+    // Serialized form of each component type, the cached matrices are rebuilt by the TransformSystem
+    struct TransformRecord {
+        glm::vec3 position;
+        glm::vec3 scale;
+        glm::vec3 rotation;
+    };
+    struct PointLightRecord {
+        float intensity;
+        glm::vec3 color;
+        float radius;
+    };
+    typedef uint32_t ModelRecord; // Index in the asset table, or NO_ASSET
+    typedef uint32_t HierarchyRecord; // Id of the parent when written
+
+    static_assert(std::is_trivially_copyable_v<TransformRecord> && sizeof(TransformRecord) == 36);
+    static_assert(std::is_trivially_copyable_v<PointLightRecord> && sizeof(PointLightRecord) == 20);
+
+    static size_t recordSize(ComponentType type) {
+        switch (type) {
+            case TRANSFORM: return sizeof(TransformRecord);
+            case MODEL: return sizeof(ModelRecord);
+            case POINT_LIGHT: return sizeof(PointLightRecord);
+            case HIERARCHY: return sizeof(HierarchyRecord);
+        } throw std::runtime_error("Component type cannot be stored in a snapshot!");
+    }
+
+    class Writer {
+    public:
+        size_t size() const { return bytes.size(); }
+        std::byte *at(size_t offset) { return bytes.data() + offset; }
+
+        size_t append(const void *data, size_t size) {
+            const size_t offset = bytes.size();
+            bytes.resize(offset + size);
+            if (size > 0) std::memcpy(bytes.data() + offset, data, size);
+            return offset;
+        }
+        template<typename T>
+        size_t append(const T &value) { return append(&value, sizeof(T)); }
+
+        void align(size_t alignment) { bytes.resize((bytes.size() + alignment - 1) & ~(alignment - 1)); }
+
+        void save(const std::string &filepath) const {
+            std::ofstream file{filepath, std::ios::binary | std::ios::trunc};
+            if (!file) throw std::runtime_error("Failed to open file: " + filepath);
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (!file) throw std::runtime_error("Failed to write file: " + filepath);
+        }
+    private:
+        std::vector<std::byte> bytes;
+    };
+
+    void write(Registry &registry, const std::string &filepath, const AssetNamer &nameAsset) {
+        std::vector<Archetype*> archetypes;
+        registry.view<>().eachArchetype([&](Archetype &archetype) { archetypes.push_back(&archetype); });
+
+        Writer writer{};
+        FileHeader header{MAGIC, VERSION, 0, static_cast<uint32_t>(archetypes.size()), 0, 0, 0, 0};
+        writer.append(header);
+        writer.align(SECTION_ALIGNMENT);
+        const size_t archetypeHeadersOffset = writer.size();
+        for (size_t i = 0; i < archetypes.size(); i++) writer.append(ArchetypeHeader{});
+
+        // Models are deduplicated, so each asset is only loaded once
+        std::vector<std::string> assetNames;
+        std::unordered_map<const Model*, uint32_t> assetIndices;
+        auto assetIndexOf = [&](const std::shared_ptr<Model> &model) -> uint32_t {
+            if (!model) return NO_ASSET;
+
+            auto found = assetIndices.find(model.get());
+            if (found != assetIndices.end()) return found->second;
+
+            std::string name = nameAsset(model);
+            uint32_t index = NO_ASSET;
+            if (!name.empty()) {
+                index = static_cast<uint32_t>(assetNames.size());
+                assetNames.push_back(std::move(name));
+            } return assetIndices[model.get()] = index;
+        };
+
+        std::vector<ArchetypeHeader> archetypeHeaders(archetypes.size());
+        for (size_t a = 0; a < archetypes.size(); a++) {
+            Archetype &archetype = *archetypes[a];
+            ArchetypeHeader &archetypeHeader = archetypeHeaders[a];
+            const size_t count = archetype.size();
+            archetypeHeader.mask = archetype.getMask();
+            archetypeHeader.count = static_cast<uint32_t>(count);
+            header.entityCount += archetypeHeader.count;
+
+            writer.align(SECTION_ALIGNMENT);
+            archetypeHeader.idsOffset = writer.append(archetype.getEntities().data(), count * sizeof(Entity::id_t));
+
+            for (size_t i = 0; i < MAX_COMPONENT_TYPES; i++) {
+                auto type = static_cast<ComponentType>(i);
+                if (!archetype.hasComponent(type)) continue;
+
+                writer.align(SECTION_ALIGNMENT);
+                archetypeHeader.columnOffsets[type] = writer.size();
+                switch (type) {
+                    case TRANSFORM: {
+                        const auto *transforms = archetype.column<TransformComponent>();
+                        for (size_t row = 0; row < count; row++)
+                            writer.append(TransformRecord{transforms[row].getPosition(),
+                                                          transforms[row].getScale(),
+                                                          transforms[row].getRotation()});
+                    } break;
+                    case MODEL: {
+                        const auto *models = archetype.column<ModelComponent>();
+                        for (size_t row = 0; row < count; row++) writer.append(assetIndexOf(models[row].model));
+                    } break;
+                    case POINT_LIGHT: {
+                        const auto *lights = archetype.column<PointLightComponent>();
+                        for (size_t row = 0; row < count; row++)
+                            writer.append(PointLightRecord{lights[row].intensity, lights[row].color, lights[row].radius});
+                    } break;
+                    case HIERARCHY: {
+                        const auto *hierarchies = archetype.column<HierarchyComponent>();
+                        for (size_t row = 0; row < count; row++) writer.append(hierarchies[row].getParent());
+                    } break;
+                    default:
+                        throw std::runtime_error("Component type cannot be stored in a snapshot!");
+                }
+            }
+        }
+
+        writer.align(SECTION_ALIGNMENT);
+        header.assetTableOffset = writer.size();
+        header.assetCount = static_cast<uint32_t>(assetNames.size());
+        for (const auto &name : assetNames) {
+            writer.append(static_cast<uint32_t>(name.size()));
+            writer.append(name.data(), name.size());
+            writer.align(alignof(uint32_t));
+        }
+
+        header.fileSize = writer.size();
+        std::memcpy(writer.at(0), &header, sizeof(FileHeader));
+        if (!archetypeHeaders.empty())
+            std::memcpy(writer.at(archetypeHeadersOffset), archetypeHeaders.data(),
+                        archetypeHeaders.size() * sizeof(ArchetypeHeader));
+        writer.save(filepath);
+    }
+
+    // Bounds checked access to the mapped file, so a truncated or corrupted snapshot throws instead of crashing
+    class Reader {
+    public:
+        explicit Reader(const MappedFile &file) : file(file) {}
+
+        template<typename T>
+        const T *at(uint64_t offset, size_t count = 1) const {
+            if (offset > file.size() || count > (file.size() - offset) / sizeof(T) || offset % alignof(T) != 0)
+                throw std::runtime_error("Scene snapshot is corrupted!");
+            return reinterpret_cast<const T*>(file.data() + offset);
+        }
+    private:
+        const MappedFile &file;
+    };
+
+    LoadStats load(Registry &registry, const std::string &filepath, const AssetLoader &loadAsset) {
+        auto start = std::chrono::steady_clock::now();
+
+        MappedFile file{filepath};
+        Reader reader{file};
+
+        const FileHeader &header = *reader.at<FileHeader>(0);
+        if (header.magic != MAGIC) throw std::runtime_error("Not a scene snapshot: " + filepath);
+        if (header.version != VERSION) throw std::runtime_error("Unsupported scene snapshot version: " + filepath);
+        if (header.fileSize != file.size()) throw std::runtime_error("Scene snapshot is truncated: " + filepath);
+
+        const size_t archetypeHeadersOffset = (sizeof(FileHeader) + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+        const auto *archetypeHeaders = reader.at<ArchetypeHeader>(archetypeHeadersOffset, header.archetypeCount);
+
+        std::vector<std::shared_ptr<Model>> assets;
+        assets.reserve(header.assetCount);
+        uint64_t assetOffset = header.assetTableOffset;
+        for (uint32_t i = 0; i < header.assetCount; i++) {
+            const uint32_t length = *reader.at<uint32_t>(assetOffset);
+            const char *name = reader.at<char>(assetOffset + sizeof(uint32_t), length);
+            assets.push_back(loadAsset(std::string{name, length}));
+            assetOffset = (assetOffset + sizeof(uint32_t) + length + alignof(uint32_t) - 1) & ~(alignof(uint32_t) - 1);
+        }
+
+        // Everything is validated before touching the registry, so a bad file can't leave half built entities behind
+        size_t entityCount = 0;
+        for (uint32_t a = 0; a < header.archetypeCount; a++) {
+            const ArchetypeHeader &archetypeHeader = archetypeHeaders[a];
+            if (archetypeHeader.mask > std::numeric_limits<ComponentType_t>::max())
+                throw std::runtime_error("Scene snapshot is corrupted!");
+
+            reader.at<Entity::id_t>(archetypeHeader.idsOffset, archetypeHeader.count);
+            entityCount += archetypeHeader.count;
+            for (size_t i = 0; i < MAX_COMPONENT_TYPES; i++) {
+                auto type = static_cast<ComponentType>(i);
+                if (!(archetypeHeader.mask & (1 << type))) continue;
+                if (!Archetype::isRegistered(type)) throw std::runtime_error("Scene snapshot has unknown components!");
+
+                reader.at<std::byte>(archetypeHeader.columnOffsets[type], archetypeHeader.count * recordSize(type));
+                if (type != MODEL) continue;
+
+                const auto *models = reader.at<ModelRecord>(archetypeHeader.columnOffsets[type], archetypeHeader.count);
+                for (uint32_t row = 0; row < archetypeHeader.count; row++)
+                    if (models[row] != NO_ASSET && models[row] >= assets.size())
+                        throw std::runtime_error("Scene snapshot is corrupted!");
+            }
+        }
+
+        std::unordered_map<Entity::id_t, Entity::id_t> remappedIds;
+        remappedIds.reserve(entityCount);
+        std::vector<Entity::id_t> hierarchyEntities;
+        std::vector<Entity::id_t> ids;
+
+        for (uint32_t a = 0; a < header.archetypeCount; a++) {
+            const ArchetypeHeader &archetypeHeader = archetypeHeaders[a];
+            const size_t count = archetypeHeader.count;
+            const auto mask = static_cast<ComponentType_t>(archetypeHeader.mask);
+
+            ids.resize(count);
+            auto [archetype, firstRow] = registry.allocateEntities(mask, count, ids.data());
+
+            const auto *oldIds = reader.at<Entity::id_t>(archetypeHeader.idsOffset, count);
+            for (size_t row = 0; row < count; row++) remappedIds[oldIds[row]] = ids[row];
+
+            for (size_t i = 0; i < MAX_COMPONENT_TYPES; i++) {
+                auto type = static_cast<ComponentType>(i);
+                if (!archetype->hasComponent(type)) continue;
+
+                const uint64_t offset = archetypeHeader.columnOffsets[type];
+                switch (type) {
+                    case TRANSFORM: {
+                        const auto *records = reader.at<TransformRecord>(offset, count);
+                        auto *transforms = archetype->column<TransformComponent>() + firstRow;
+                        for (size_t row = 0; row < count; row++)
+                            new (transforms + row) TransformComponent(records[row].position,
+                                                                      records[row].scale,
+                                                                      records[row].rotation);
+                    } break;
+                    case MODEL: {
+                        const auto *records = reader.at<ModelRecord>(offset, count);
+                        auto *models = archetype->column<ModelComponent>() + firstRow;
+                        for (size_t row = 0; row < count; row++)
+                            new (models + row) ModelComponent(records[row] == NO_ASSET ? nullptr : assets[records[row]]);
+                    } break;
+                    case POINT_LIGHT: {
+                        const auto *records = reader.at<PointLightRecord>(offset, count);
+                        auto *lights = archetype->column<PointLightComponent>() + firstRow;
+                        for (size_t row = 0; row < count; row++)
+                            new (lights + row) PointLightComponent(records[row].intensity, records[row].color, records[row].radius);
+                    } break;
+                    case HIERARCHY: {
+                        // Still pointing at the old ids, fixed once every entity exists
+                        const auto *records = reader.at<HierarchyRecord>(offset, count);
+                        auto *hierarchies = archetype->column<HierarchyComponent>() + firstRow;
+                        for (size_t row = 0; row < count; row++) new (hierarchies + row) HierarchyComponent(records[row]);
+                        hierarchyEntities.insert(hierarchyEntities.end(), ids.begin(), ids.end());
+                    } break;
+                }
+            }
+        }
+
+        for (Entity::id_t id : hierarchyEntities) {
+            auto &hierarchy = registry.getComponent<HierarchyComponent>(id);
+            auto parent = remappedIds.find(hierarchy.getParent());
+            hierarchy = HierarchyComponent{parent != remappedIds.end() ? parent->second : Entity::NULL_ID};
+        }
+
+        LoadStats stats{};
+        stats.entityCount = entityCount;
+        stats.archetypeCount = header.archetypeCount;
+        stats.assetCount = header.assetCount;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <functional>
+
+#include "../entity/entity.hpp"
+
+// Binary scene snapshots: every archetype of a registry written out as its entity ids plus one flat array per component
+// column, with models referenced by name through an asset table. Loading maps the file and copies the arrays straight
+// into freshly allocated archetype rows, there's nothing to parse besides the headers.
+// The layout is the native one of the machine writing it (little endian, IEEE floats), it's meant as a cache for fast
+// startup and level switches, not as an interchange format.
+namespace Engine::SceneSnapshot {
+    constexpr uint32_t VERSION = 2; // Bump on any layout change, older files are rejected
+
+    // Name used to find a model again when loading, an empty name stores the entity without a model
+    using AssetNamer = std::function<std::string(const std::shared_ptr<Model>&)>;
+    // Called once per asset referenced by the snapshot
+    using AssetLoader = std::function<std::shared_ptr<Model>(const std::string&)>;
+
+    struct LoadStats {
+        size_t entityCount = 0;
+        size_t archetypeCount = 0;
+        size_t assetCount = 0;
+        double seconds = 0.0;
+    };
+
+    void write(Registry &registry, const std::string &filepath, const AssetNamer &nameAsset);
+
+    // Adds the entities of the snapshot to the registry. They get new ids, parents of hierarchies are remapped to them.
+    LoadStats load(Registry &registry, const std::string &filepath, const AssetLoader &loadAsset);
+}
+
+#endif
@@ -25,7 +25,7 @@ namespace Engine {
         for (unsigned int i = 0; i < depthImages.size(); i++) {
             vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
             vkDestroyImage(device.device(), depthImages[i], nullptr);
-            vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+            device.getAllocator().free(depthImageMemorys[i]);
         }
 
         for (auto framebuffer : swapChainFramebuffers)
@@ -86,7 +86,7 @@ namespace Engine {
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+        if (device.submit(device.graphicsQueue(), submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
             throw std::runtime_error("Failed to submit draw command buffer!");
 
         VkPresentInfoKHR presentInfo = {};
@@ -101,7 +101,7 @@ namespace Engine {
 
         presentInfo.pImageIndices = imageIndex;
 
-        auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+        auto result = device.present(presentInfo);
 
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
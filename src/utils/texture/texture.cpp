@@ -2,7 +2,7 @@
 
 namespace Engine {
     Texture::Texture(Device &device, const char *texturePath) : device(device), texturePath(texturePath) {
-        createTextureImage();
+        createTextureImage(loadPixels());
         textureImageView = textureImage->createImageView();
         createTextureSampler();
     }
@@ -12,46 +12,42 @@ namespace Engine {
         vkDestroyImageView(device.device(), textureImageView, nullptr);
     };
 
-    void Texture::createTextureImage () {
-        int texWidth, texHeight, texChannels;
-        stbi_uc* pixels = stbi_load(texturePath,
-                                    &texWidth,
-                                    &texHeight,
-                                    &texChannels,
-                                    STBI_rgb_alpha);
-        VkDeviceSize imageSize = 4 * static_cast<VkDeviceSize>(texWidth) * static_cast<VkDeviceSize>(texHeight);
-
-        if (!pixels) throw std::runtime_error("Failed to load the texture image!");
+    void Texture::evict() {
+        vkDestroyImageView(device.device(), textureImageView, nullptr);
+        textureImageView = VK_NULL_HANDLE;
+        textureImage.reset();
+    }
 
-        Buffer stagingBuffer{
-                device,
-                imageSize,
-                1,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
+    UploadManager::Handle Texture::restore(const Pixels &pixels) {
+        assert(!isResident() && "Texture is already resident!");
+        createTextureImage(pixels); // Same file, same size and mip count, so the sampler still fits
+        textureImageView = textureImage->createImageView();
+        return uploadHandle;
+    }
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer(pixels, imageSize);
+    Texture::Pixels Texture::loadPixels() const {
+        int texWidth, texHeight, texChannels;
+        Pixels pixels;
+        pixels.data.reset(stbi_load(texturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha));
+        if (!pixels.data) throw std::runtime_error("Failed to load the texture image!");
 
-        stbi_image_free(pixels);
+        pixels.width = static_cast<uint32_t>(texWidth);
+        pixels.height = static_cast<uint32_t>(texHeight);
+        return pixels;
+    }
 
+    void Texture::createTextureImage(const Pixels &pixels) {
         textureImage = std::make_unique<Image>(
                 device,
-                static_cast<uint32_t>(texWidth),
-                static_cast<uint32_t>(texHeight),
+                pixels.width,
+                pixels.height,
                 VK_FORMAT_R8G8B8A8_SRGB,
                 VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        textureImage->transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED,
-                                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        textureImage->copyBufferToImage(stagingBuffer.getBuffer());
-        textureImage->transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED,
-                                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        textureImage->copyBufferToImage(stagingBuffer.getBuffer());
-        textureImage->generateMipmaps();
-        stagingBuffer.unmap();
+
+        // The pixels are staged right away, the copy and mipmaps run with the next upload batch
+        uploadHandle = device.getUploadManager().uploadImage(*textureImage, pixels.data.get(), pixels.size());
     }
 
     void Texture::createTextureSampler() {
@@ -5,6 +5,7 @@
 
 #include <stdexcept>
 #include <memory>
+#include <string>
 
 #include <vulkan/vulkan_core.h>
 #include <vulkan/vulkan.h>
@@ -12,10 +13,20 @@
 #include "../device/device.hpp"
 #include "../buffer/buffer.hpp"
 #include "../image/image.hpp"
+#include "../upload/uploadmanager.hpp"
 
 namespace Engine {
     class Texture {
     public:
+        // Decoded RGBA8 file contents
+        struct Pixels {
+            std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> data{nullptr, stbi_image_free};
+            uint32_t width = 0;
+            uint32_t height = 0;
+
+            VkDeviceSize size() const { return 4 * static_cast<VkDeviceSize>(width) * height; }
+        };
+
         Texture(Device &device, const char* texturePath);
         ~Texture();
 
@@ -25,15 +36,28 @@ namespace Engine {
         Texture& operator=(Texture &&) = delete;
 
         VkDescriptorImageInfo getDescriptorImageInfo() const;
+
+        // Residency, see ResidencyManager. While evicted, the image and its view are gone, and the descriptor image
+        // info is stale until restore. loadPixels reads the file again, it touches no Vulkan object, so it can run on
+        // any thread, restore then uploads them and returns the handle of the upload. The texture mustn't be sampled
+        // before it completes.
+        bool isResident() const { return textureImage != nullptr; }
+        void evict();
+        Pixels loadPixels() const;
+        UploadManager::Handle restore(const Pixels &pixels);
+        UploadManager::Handle getUploadHandle() const { return uploadHandle; }
+        VkDeviceSize getMemorySize() const { return textureImage ? textureImage->getMemorySize() : 0; }
+        uint32_t getMemoryType() const { return textureImage->getMemoryType(); }
     private:
         Device &device;
         std::unique_ptr<Image> textureImage;
-        VkImageView textureImageView;
+        VkImageView textureImageView = VK_NULL_HANDLE;
         VkSampler textureSampler;
+        UploadManager::Handle uploadHandle = 0;
 
-        const char* texturePath;
+        std::string texturePath;
 
-        void createTextureImage();
+        void createTextureImage(const Pixels &pixels);
         void createTextureSampler();
     };
 }
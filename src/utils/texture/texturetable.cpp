@@ -0,0 +1,46 @@
+#include "texturetable.hpp"
+
+namespace Engine {
+    TextureTable::TextureTable(Device &device) {
+        // Partially bound: slots past the registered textures are never written, which is fine as long as they aren't
+        // sampled. Update after bind and unused while pending: slots can be written while earlier frames still use the
+        // set, as long as these frames don't sample them.
+        setLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0,
+                            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                            VK_SHADER_STAGE_FRAGMENT_BIT,
+                            MAX_TEXTURES,
+                            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT)
+                .build();
+        pool = DescriptorPool::Builder(device)
+                .setMaxSets(1)
+                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TEXTURES)
+                .build();
+
+        if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet))
+            throw std::runtime_error("Failed to allocate the texture table descriptor set!");
+    }
+
+    uint32_t TextureTable::add(std::shared_ptr<Texture> texture) {
+        assert(texture && "Cannot register a null texture!");
+        if (auto it = indices.find(texture.get()); it != indices.end()) return it->second;
+        if (textures.size() >= MAX_TEXTURES) throw std::runtime_error("Texture table is full!");
+
+        const auto index = static_cast<uint32_t>(textures.size());
+        indices.emplace(texture.get(), index);
+        textures.push_back(std::move(texture));
+        refresh(index);
+        return index;
+    }
+
+    void TextureTable::refresh(uint32_t index) {
+        assert(index < textures.size() && "Texture index out of range!");
+        VkDescriptorImageInfo imageInfo = textures[index]->getDescriptorImageInfo();
+        DescriptorWriter(*setLayout, *pool)
+            .writeImage(0, &imageInfo, index)
+            .overwrite(descriptorSet);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef TEXTURETABLE_HPP
+#define TEXTURETABLE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "texture.hpp"
+#include "../descriptors/descriptors.hpp"
+
+namespace Engine {
+    // Bindless texture table: a single descriptor set holding one large, partially bound `sampler2D textures[]` array.
+    // Textures are registered once and referred to by their index from then on (see ModelComponent::textureIndex), so
+    // switching textures never costs a descriptor set rebind, and a single instanced draw can mix any of them.
+    // Shaders see it as `layout (set = TextureTable::SET, binding = 0) uniform sampler2D textures[]`.
+    class TextureTable {
+    public:
+        static constexpr uint32_t SET = 2; // After the global (0) and instance (1) sets, before the lights (3)
+        static constexpr uint32_t MAX_TEXTURES = 4096; // Far below what update after bind arrays allow on any device
+
+        explicit TextureTable(Device &device);
+
+        TextureTable(const TextureTable &) = delete;
+        TextureTable& operator=(const TextureTable &) = delete;
+
+        // Returns the index the shaders use for the texture, registering it on the first call. Descriptors are
+        // update after bind, so this is fine while frames using the table are in flight, but only from the main thread.
+        uint32_t add(std::shared_ptr<Texture> texture);
+        // Writes the slot again, for textures whose image was recreated. It mustn't be sampled by any pending frame.
+        void refresh(uint32_t index);
+
+        Texture &get(uint32_t index) const { return *textures[index]; }
+        uint32_t size() const { return static_cast<uint32_t>(textures.size()); }
+
+        VkDescriptorSetLayout getSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+        VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+    private:
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        std::unique_ptr<DescriptorPool> pool;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+        std::vector<std::shared_ptr<Texture>> textures; // Kept alive as long as their slot can be sampled
+        std::unordered_map<const Texture*, uint32_t> indices;
+    };
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FIXEDTIMESTEP_HPP
+#define FIXEDTIMESTEP_HPP
+
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+namespace Engine {
+    // Accumulates frame time and hands it out in fixed steps, so the simulation runs at the same rate whatever the frame
+    // rate is. Whatever is left in the accumulator tells how far between the last two steps the frame is, which is what
+    // the renderer interpolates with (see TransformComponent::interpolate).
+    class FixedTimestep {
+    public:
+        explicit FixedTimestep(float rate = 60.0f, uint32_t maxStepsPerFrame = 5) : maxStepsPerFrame(maxStepsPerFrame) {
+            setRate(rate);
+        }
+
+        // Steps per second
+        void setRate(float rate) {
+            assert(rate > 0.0f && "Simulation rate must be positive!");
+            step = 1.0f / rate;
+        }
+        float getStep() const { return step; }
+
+        // Adds the time of a frame and returns how many steps to run for it. Past maxStepsPerFrame, the time is dropped
+        // and the simulation slows down instead of spiraling into ever longer frames.
+        uint32_t advance(float frameTime) {
+            accumulator += frameTime;
+
+            uint32_t steps = 0;
+            while (accumulator >= step && steps < maxStepsPerFrame) {
+                accumulator -= step;
+                steps++;
+            }
+
+            accumulator = std::min(accumulator, step);
+            return steps;
+        }
+
+        // How far the frame is between the previous step (0) and the last one (1)
+        float getAlpha() const { return accumulator / step; }
+    private:
+        float step = 1.0f / 60.0f;
+        float accumulator = 0.0f;
+        uint32_t maxStepsPerFrame;
+    };
+}
+
+#endif
@@ -0,0 +1,368 @@
+#include "uploadmanager.hpp"
+#include "../device/device.hpp"
+#include "../image/image.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+namespace Engine {
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    static VkCommandPool createCommandPool(VkDevice device, uint32_t queueFamily) {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = queueFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        VkCommandPool commandPool;
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the upload command pool!");
+        return commandPool;
+    }
+
+    UploadManager::UploadManager(Device &device) :
+            device(device),
+            queue(device.transferQueue()),
+            queueFamily(device.transferFamily()),
+            graphicsFamily(device.findPhysicalQueueFamilies().graphicsFamily),
+            dedicatedQueue(device.hasDedicatedTransferQueue()) {
+        commandPool = createCommandPool(device.device(), queueFamily);
+        if (dedicatedQueue) acquireCommandPool = createCommandPool(device.device(), graphicsFamily);
+
+        // Buffer to image copies need offsets aligned to the texel size, 16 covers every uncompressed format
+        copyAlignment = std::max<VkDeviceSize>(16, device.properties.limits.optimalBufferCopyOffsetAlignment);
+
+        ring = std::make_unique<Buffer>(device,
+                                        RING_SIZE,
+                                        1,
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        ring->map();
+    }
+
+    UploadManager::~UploadManager() {
+        waitIdle();
+
+        if (recording.fence) vkDestroyFence(device.device(), recording.fence, nullptr);
+        for (auto &batch : freeBatches) vkDestroyFence(device.device(), batch.fence, nullptr);
+        vkDestroyCommandPool(device.device(), commandPool, nullptr); // Frees the command buffers along with it
+        if (acquireCommandPool) vkDestroyCommandPool(device.device(), acquireCommandPool, nullptr);
+    }
+
+    UploadManager::Handle UploadManager::uploadBuffer(VkBuffer dstBuffer,
+                                                      const void *data,
+                                                      VkDeviceSize size,
+                                                      VkDeviceSize dstOffset) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        VkBufferCopy region{};
+        VkBuffer srcBuffer = stage(data, size, region.srcOffset);
+        region.dstOffset = dstOffset;
+        region.size = size;
+        vkCmdCopyBuffer(getCommandBuffer(), srcBuffer, dstBuffer, 1, &region);
+
+        if (dedicatedQueue) {
+            VkBufferMemoryBarrier release{};
+            release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            release.srcQueueFamilyIndex = queueFamily;
+            release.dstQueueFamilyIndex = graphicsFamily;
+            release.buffer = dstBuffer;
+            release.offset = dstOffset;
+            release.size = size;
+            recording.bufferReleases.push_back(release);
+        }
+
+        recording.uploadCount++;
+        stats.uploadCount++;
+        stats.uploadedBytes += size;
+        return recording.handle;
+    }
+
+    UploadManager::Handle UploadManager::uploadImage(Image &image, const void *pixels, VkDeviceSize size) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        VkDeviceSize srcOffset;
+        VkBuffer srcBuffer = stage(pixels, size, srcOffset);
+
+        VkCommandBuffer commandBuffer = getCommandBuffer();
+        image.transitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        image.copyBufferToImage(commandBuffer, srcBuffer, srcOffset);
+
+        VkCommandBuffer acquireCommandBuffer = getAcquireCommandBuffer();
+        if (dedicatedQueue) {
+            // Same barrier on both sides, the layout stays as the mipmaps want it
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = queueFamily;
+            barrier.dstQueueFamilyIndex = graphicsFamily;
+            barrier.image = image.getImage();
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, image.getMipLevels(), 0, 1};
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                 0, nullptr,
+                                 0, nullptr,
+                                 1, &barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(acquireCommandBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                 0, nullptr,
+                                 0, nullptr,
+                                 1, &barrier);
+        }
+        image.generateMipmaps(acquireCommandBuffer);
+
+        recording.uploadCount++;
+        stats.uploadCount++;
+        stats.uploadedBytes += size;
+        return recording.handle;
+    }
+
+    UploadManager::Handle UploadManager::flush() {
+        std::lock_guard<std::mutex> lock{mutex};
+        retire(false); // Good time to reclaim ring space, this gets called every frame
+        if (recording.commandBuffer) return submit();
+        return nextHandle - 1;
+    }
+
+    bool UploadManager::isComplete(Handle handle) {
+        std::lock_guard<std::mutex> lock{mutex};
+        retire(false);
+        return handle <= completedHandle;
+    }
+
+    void UploadManager::wait(Handle handle) {
+        std::lock_guard<std::mutex> lock{mutex};
+        waitFor(handle);
+    }
+
+    void UploadManager::waitIdle() {
+        std::lock_guard<std::mutex> lock{mutex};
+        waitFor(nextHandle - 1);
+    }
+
+    VkBuffer UploadManager::stage(const void *data, VkDeviceSize size, VkDeviceSize &offset) {
+        // Too big to share the ring, it would have to be drained every time
+        if (size > RING_SIZE / 2) {
+            auto staging = std::make_unique<Buffer>(device,
+                                                    size,
+                                                    1,
+                                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            staging->map();
+            staging->writeToBuffer(const_cast<void*>(data), size);
+
+            offset = 0;
+            recording.oversized.push_back(std::move(staging));
+            return recording.oversized.back()->getBuffer();
+        }
+
+        while (!reserveRing(size, offset)) {
+            // Out of space, wait on the oldest batch to get some back. If that's the one recording, it goes out first
+            if (inFlight.empty()) {
+                assert(recording.commandBuffer && "Upload ring is full but no batch is holding it!");
+                submit();
+            }
+            retire(true);
+            stats.stallCount++;
+        }
+
+        std::memcpy(static_cast<std::byte*>(ring->getMappedMemory()) + offset, data, size);
+        return ring->getBuffer();
+    }
+
+    bool UploadManager::reserveRing(VkDeviceSize size, VkDeviceSize &offset) {
+        if (ringUsed == 0) ringHead = ringTail = 0;
+
+        const VkDeviceSize start = alignUp(ringHead, copyAlignment);
+        VkDeviceSize consumed;
+        if (ringHead > ringTail || ringUsed == 0) {
+            // Free space is [head, end) then [0, tail), wrapping around wastes the end
+            if (start + size <= RING_SIZE) {
+                offset = start;
+                consumed = start + size - ringHead;
+            } else if (size <= ringTail) {
+                offset = 0;
+                consumed = RING_SIZE - ringHead + size;
+            } else return false;
+        } else {
+            // Free space is [head, tail)
+            if (start + size > ringTail) return false;
+            offset = start;
+            consumed = start + size - ringHead;
+        }
+
+        ringHead = offset + size;
+        ringUsed += consumed;
+        recording.ringBytes += consumed;
+        recording.ringEnd = ringHead;
+        return true;
+    }
+
+    VkCommandBuffer UploadManager::allocateCommandBuffer(VkCommandPool pool) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = pool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate an upload command buffer!");
+        return commandBuffer;
+    }
+
+    VkCommandBuffer UploadManager::getCommandBuffer() {
+        if (recording.commandBuffer) return recording.commandBuffer;
+
+        // Reuse the command buffers and fence of a finished batch, or make new ones
+        if (!freeBatches.empty()) {
+            recording.commandBuffer = freeBatches.back().commandBuffer;
+            recording.acquireCommandBuffer = freeBatches.back().acquireCommandBuffer;
+            recording.fence = freeBatches.back().fence;
+            freeBatches.pop_back();
+        } else {
+            recording.commandBuffer = allocateCommandBuffer(commandPool);
+            if (dedicatedQueue) recording.acquireCommandBuffer = allocateCommandBuffer(acquireCommandPool);
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(device.device(), &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create an upload fence!");
+        }
+
+        // Every upload has something to do on the graphics side when going through a transfer queue, so both are begun
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(recording.commandBuffer, &beginInfo) != VK_SUCCESS ||
+            (dedicatedQueue && vkBeginCommandBuffer(recording.acquireCommandBuffer, &beginInfo) != VK_SUCCESS))
+            throw std::runtime_error("Failed to begin recording an upload command buffer!");
+
+        recording.handle = nextHandle++;
+        return recording.commandBuffer;
+    }
+
+    VkCommandBuffer UploadManager::getAcquireCommandBuffer() {
+        getCommandBuffer();
+        return dedicatedQueue ? recording.acquireCommandBuffer : recording.commandBuffer;
+    }
+
+    UploadManager::Handle UploadManager::submit() {
+        auto &releases = recording.bufferReleases;
+        if (!releases.empty()) {
+            vkCmdPipelineBarrier(recording.commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(releases.size()), releases.data(),
+                                 0, nullptr);
+
+            // The matching acquires, same barriers with the access masks of the destination side
+            for (auto &barrier : releases) {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                        VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            }
+            vkCmdPipelineBarrier(recording.acquireCommandBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(releases.size()), releases.data(),
+                                 0, nullptr);
+            releases.clear();
+        }
+
+        // Barriers reach across submissions on a queue, so this covers every later use of the uploaded data
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(getAcquireCommandBuffer(),
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             1, &barrier,
+                             0, nullptr,
+                             0, nullptr);
+
+        if (vkEndCommandBuffer(recording.commandBuffer) != VK_SUCCESS ||
+            (dedicatedQueue && vkEndCommandBuffer(recording.acquireCommandBuffer) != VK_SUCCESS))
+            throw std::runtime_error("Failed to record an upload command buffer!");
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &recording.commandBuffer;
+        if (device.submit(queue, submitInfo, recording.fence) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit an upload batch!");
+
+        stats.submitCount++;
+        const Handle handle = recording.handle;
+        inFlight.push_back(std::move(recording));
+        recording = {};
+        return handle;
+    }
+
+    void UploadManager::submitAcquire(Batch &batch) {
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.acquireCommandBuffer;
+        if (device.submit(device.graphicsQueue(), submitInfo, batch.fence) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit an upload acquire batch!");
+
+        batch.acquiring = true;
+        stats.submitCount++;
+    }
+
+    void UploadManager::retire(bool waitOldest) {
+        while (!inFlight.empty()) {
+            Batch &batch = inFlight.front();
+            if (waitOldest) {
+                vkWaitForFences(device.device(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+                waitOldest = false;
+            } else if (vkGetFenceStatus(device.device(), batch.fence) != VK_SUCCESS) break;
+            vkResetFences(device.device(), 1, &batch.fence);
+
+            // The copies are done, and so is the staging memory. Batches finish in order, so the tail of the ring
+            // just follows them
+            if (batch.ringBytes > 0) ringTail = batch.ringEnd;
+            ringUsed -= batch.ringBytes;
+            batch.ringBytes = 0;
+            batch.oversized.clear();
+
+            // Only now does the graphics queue get to take the resources over, so it never waits on the transfer queue
+            if (dedicatedQueue && !batch.acquiring) {
+                submitAcquire(batch);
+                continue;
+            }
+
+            completedHandle = batch.handle;
+            Batch &recycled = freeBatches.emplace_back();
+            recycled.commandBuffer = batch.commandBuffer; // Reset when they begin recording again
+            recycled.acquireCommandBuffer = batch.acquireCommandBuffer;
+            recycled.fence = batch.fence;
+            inFlight.pop_front();
+        }
+    }
+
+    void UploadManager::waitFor(Handle handle) {
+        if (handle <= completedHandle) return;
+        if (recording.commandBuffer && handle >= recording.handle) submit();
+        while (handle > completedHandle && !inFlight.empty()) retire(true);
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef UPLOADMANAGER_HPP
+#define UPLOADMANAGER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+#include "../buffer/buffer.hpp"
+
+namespace Engine {
+    class Device;
+    class Image;
+
+    // Streams data to device local buffers and images without stalling the GPU.
+    // Data is copied right away into a persistently mapped ring staging buffer, and the copies (and whatever layout
+    // transitions go with them) are recorded into the command buffer of the current batch. flush() submits the batch
+    // with a fence, so any number of uploads cost a single submit, and the ring space of a batch is reclaimed once its
+    // fence signals. Each upload returns the handle of its batch to check or wait for its completion.
+    //
+    // When the device has a transfer only queue, the copies run there, overlapping with rendering. Resources are
+    // exclusive to a queue family, so the batch ends releasing them to the graphics family, and once its copies are
+    // done, a second, small command buffer acquires them on the graphics queue (and generates mipmaps, blits being
+    // graphics only). That one is only submitted after the copies finished, so frames never wait on the transfer queue,
+    // but a resource mustn't be drawn with before its handle completes.
+    //
+    // Without a transfer queue, everything is recorded into one command buffer on the graphics queue, ending with a
+    // barrier making the writes visible to every later submission there.
+    //
+    // Uploading and flushing are safe from any thread.
+    class UploadManager {
+    public:
+        using Handle = uint64_t; // 0 is never handed out, and always complete
+
+        static constexpr VkDeviceSize RING_SIZE = 64 * 1024 * 1024;
+
+        struct Stats {
+            uint64_t uploadCount = 0;
+            uint64_t submitCount = 0;
+            uint64_t stallCount = 0; // Times the ring was full and the CPU had to wait on the GPU
+            VkDeviceSize uploadedBytes = 0;
+        };
+
+        explicit UploadManager(Device &device);
+        ~UploadManager();
+
+        UploadManager(const UploadManager &) = delete;
+        UploadManager &operator=(const UploadManager &) = delete;
+
+        // Copies size bytes of data to dstBuffer at dstOffset
+        Handle uploadBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+        // Fills the first mip level of an image with tightly packed pixels, then generates the others and leaves it
+        // in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        Handle uploadImage(Image &image, const void *pixels, VkDeviceSize size);
+
+        // Submits the uploads recorded so far, if any, and returns the handle covering all of them
+        Handle flush();
+
+        bool isComplete(Handle handle);
+        void wait(Handle handle); // Flushes first if the handle is still recording
+        void waitIdle();
+
+        const Stats &getStats() const { return stats; }
+    private:
+        struct Batch {
+            Handle handle = 0;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE; // On the upload queue
+            VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE; // On the graphics queue, with a transfer queue only
+            VkFence fence = VK_NULL_HANDLE; // Signaled by the copies, then by the acquire
+            bool acquiring = false;
+            std::vector<VkBufferMemoryBarrier> bufferReleases; // Recorded on both queues when the batch is submitted
+            VkDeviceSize ringEnd = 0; // Ring head after the batch's last upload, the tail moves there once it's done
+            VkDeviceSize ringBytes = 0; // Ring space taken, alignment and wrap around included
+            std::vector<std::unique_ptr<Buffer>> oversized; // Uploads that don't fit in the ring get their own staging
+            uint32_t uploadCount = 0;
+        };
+
+        Device &device;
+        VkQueue queue;
+        uint32_t queueFamily;
+        uint32_t graphicsFamily;
+        bool dedicatedQueue; // Whether uploads go through a transfer queue rather than the graphics one
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandPool acquireCommandPool = VK_NULL_HANDLE;
+        VkDeviceSize copyAlignment;
+
+        std::unique_ptr<Buffer> ring;
+        VkDeviceSize ringHead = 0;
+        VkDeviceSize ringTail = 0;
+        VkDeviceSize ringUsed = 0;
+
+        Batch recording{}; // Commands are only begun on the first upload
+        std::deque<Batch> inFlight; // In submission order
+        std::vector<Batch> freeBatches;
+        Handle nextHandle = 1;
+        Handle completedHandle = 0; // Every batch up to this one is done
+
+        Stats stats{};
+        std::mutex mutex;
+
+        // Copies data into staging memory, returning the buffer and offset to copy from
+        VkBuffer stage(const void *data, VkDeviceSize size, VkDeviceSize &offset);
+        bool reserveRing(VkDeviceSize size, VkDeviceSize &offset);
+
+        VkCommandBuffer getCommandBuffer();
+        VkCommandBuffer getAcquireCommandBuffer(); // The graphics side of the batch, the same one without transfer queue
+        VkCommandBuffer allocateCommandBuffer(VkCommandPool pool);
+        Handle submit();
+        void submitAcquire(Batch &batch);
+        void retire(bool waitOldest);
+        void waitFor(Handle handle);
+    };
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+// Unlike assert, still checks in release builds. Stops the test at the first failure
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        std::exit(EXIT_FAILURE); \
+    } \
+} while (false)
+
+#endif
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "utils/renderqueue/renderqueue.hpp"
+
+using namespace Engine;
+
+namespace {
+    void testKeys() {
+        const uint64_t key = RenderQueue::makeKey(3, 200, 4000, 60000, 12.5f);
+        CHECK(RenderQueue::getPass(key) == 3);
+        CHECK(RenderQueue::getPipeline(key) == 200);
+        CHECK(RenderQueue::getMaterial(key) == 4000);
+        CHECK(RenderQueue::getMesh(key) == 60000);
+
+        // Wider fields are truncated rather than spilling into their neighbours
+        const uint64_t truncated = RenderQueue::makeKey(0x13, 0x1FF, 0, 0, 0.0f);
+        CHECK(RenderQueue::getPass(truncated) == 3 && RenderQueue::getPipeline(truncated) == 0xFF);
+        CHECK(RenderQueue::getMaterial(truncated) == 0);
+
+        // Nearer sorts first, whatever lies behind the camera counts as 0
+        CHECK(RenderQueue::makeKey(0, 0, 0, 0, 1.0f) < RenderQueue::makeKey(0, 0, 0, 0, 2.0f));
+        CHECK(RenderQueue::makeKey(0, 0, 0, 0, 100.0f) < RenderQueue::makeKey(0, 0, 0, 0, 1000.0f));
+        CHECK(RenderQueue::makeKey(0, 0, 0, 0, -5.0f) == RenderQueue::makeKey(0, 0, 0, 0, 0.0f));
+        // State outranks depth
+        CHECK(RenderQueue::makeKey(0, 0, 0, 1, 0.0f) > RenderQueue::makeKey(0, 0, 0, 0, 1e30f));
+        CHECK(RenderQueue::makeKey(1, 0, 0, 0, 0.0f) > RenderQueue::makeKey(0, 255, 4095, 65535, 1e30f));
+
+        CHECK(RenderQueue::sameState(RenderQueue::makeKey(1, 2, 3, 4, 1.0f), RenderQueue::makeKey(1, 2, 3, 4, 50.0f)));
+        CHECK(!RenderQueue::sameState(RenderQueue::makeKey(1, 2, 3, 4, 1.0f), RenderQueue::makeKey(1, 2, 3, 5, 1.0f)));
+    }
+
+    // Same order as a stable comparison sort, packets sharing a key in submission order
+    void checkSorted(RenderQueue &queue) {
+        std::vector<RenderQueue::Packet> expected(queue.getPackets().begin(), queue.getPackets().end());
+        std::stable_sort(expected.begin(), expected.end(), [](const auto &a, const auto &b) { return a.key < b.key; });
+
+        queue.sort();
+        CHECK(queue.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            CHECK(queue.getPackets()[i].key == expected[i].key);
+            CHECK(queue.getPackets()[i].index == expected[i].index);
+        }
+    }
+
+    void testSort() {
+        std::mt19937 random{3};
+        RenderQueue queue;
+
+        // Few distinct states, so many keys repeat and stability matters
+        std::uniform_int_distribution<uint32_t> state{0, 3};
+        std::uniform_real_distribution<float> depth{-10.0f, 500.0f};
+        for (uint32_t i = 0; i < 10'000; i++)
+            queue.submit(RenderQueue::makeKey(state(random), state(random), state(random), state(random),
+                                              std::floor(depth(random))), i);
+        checkSorted(queue);
+
+        // Every byte random, no pass gets skipped
+        queue.clear();
+        for (uint32_t i = 0; i < 10'000; i++) queue.submit(uint64_t{random()} << 32 | random(), i);
+        checkSorted(queue);
+
+        // Only the depth varies, the bytes every key shares are skipped
+        queue.clear();
+        for (uint32_t i = 0; i < 1000; i++) queue.submit(RenderQueue::makeKey(2, 7, 9, 11, depth(random)), i);
+        checkSorted(queue);
+
+        // Nothing to sort
+        queue.clear();
+        queue.submit(5, 0);
+        checkSorted(queue);
+        queue.clear();
+        checkSorted(queue);
+    }
+}
+
+int main() {
+    testKeys();
+    testSort();
+    return EXIT_SUCCESS;
+}
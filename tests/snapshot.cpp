@@ -0,0 +1,135 @@
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "check.hpp"
+#include "utils/scene/snapshot.hpp"
+
+using namespace Engine;
+
+namespace {
+    // Entities are told apart by the x of their position, ids change on load
+    constexpr size_t MESH_COUNT = 300;
+    constexpr size_t LIGHT_COUNT = 20;
+    constexpr size_t CHILD_COUNT = 50;
+
+    const SceneSnapshot::AssetNamer NO_NAMES = [](const std::shared_ptr<Model>&) { return std::string{}; };
+    const SceneSnapshot::AssetLoader NO_ASSETS = [](const std::string&) -> std::shared_ptr<Model> {
+        throw std::runtime_error("No asset should be loaded!");
+    };
+
+    glm::vec3 positionOf(size_t i) { return {static_cast<float>(i), 2.0f, -3.0f}; }
+
+    void fill(Registry &registry) {
+        std::vector<Entity::id_t> meshes(MESH_COUNT);
+        registry.createEntities<TransformComponent, ModelComponent>(MESH_COUNT, [](size_t i, TransformComponent *transform,
+                                                                                   ModelComponent *model) {
+            new (transform) TransformComponent(positionOf(i), {1.0f, 2.0f, 3.0f}, {0.1f, 0.2f, static_cast<float>(i)});
+            new (model) ModelComponent(nullptr);
+        }, meshes.data());
+
+        for (size_t i = 0; i < LIGHT_COUNT; i++) {
+            Entity light = registry.createEntity();
+            light.addComponent<TransformComponent>(positionOf(MESH_COUNT + i));
+            light.addComponent<PointLightComponent>(static_cast<float>(i + 1), glm::vec3{0.5f, 0.25f, 1.0f}, 7.0f);
+        }
+
+        // Children of the first meshes
+        for (size_t i = 0; i < CHILD_COUNT; i++) {
+            Entity child = registry.createEntity();
+            child.addComponent<TransformComponent>(positionOf(MESH_COUNT + LIGHT_COUNT + i));
+            child.addComponent<HierarchyComponent>(meshes[i]);
+        }
+    }
+
+    std::unordered_map<float, Entity::id_t> idsByX(Registry &registry) {
+        std::unordered_map<float, Entity::id_t> ids;
+        registry.view<TransformComponent>().eachWithId([&](Entity::id_t id, TransformComponent &transform) {
+            ids[transform.getPosition().x] = id;
+        });
+        return ids;
+    }
+
+    void testRoundTrip(const std::string &path) {
+        Registry original;
+        fill(original);
+        SceneSnapshot::write(original, path, NO_NAMES);
+
+        Registry loaded;
+        loaded.createEntity().addComponent<TransformComponent>(glm::vec3{-1.0f}); // Loading adds to what's there
+        const SceneSnapshot::LoadStats stats = SceneSnapshot::load(loaded, path, NO_ASSETS);
+        CHECK(stats.entityCount == MESH_COUNT + LIGHT_COUNT + CHILD_COUNT);
+        CHECK(stats.archetypeCount == 3 && stats.assetCount == 0);
+        CHECK(loaded.size() == original.size() + 1);
+
+        const auto originalIds = idsByX(original);
+        const auto loadedIds = idsByX(loaded);
+        for (const auto &[x, originalId] : originalIds) {
+            const auto found = loadedIds.find(x);
+            CHECK(found != loadedIds.end());
+            Entity before = original.getEntity(originalId), after = loaded.getEntity(found->second);
+            CHECK(before.getComponentMask() == after.getComponentMask());
+
+            const auto &transform = after.getComponent<TransformComponent>();
+            CHECK(transform.getPosition() == before.getComponent<TransformComponent>().getPosition());
+            CHECK(transform.getScale() == before.getComponent<TransformComponent>().getScale());
+            CHECK(transform.getRotation() == before.getComponent<TransformComponent>().getRotation());
+
+            if (after.hasComponent(MODEL)) CHECK(after.getComponent<ModelComponent>().model == nullptr);
+            if (after.hasComponent(POINT_LIGHT)) {
+                const auto &light = after.getComponent<PointLightComponent>();
+                const auto &expected = before.getComponent<PointLightComponent>();
+                CHECK(light.intensity == expected.intensity && light.color == expected.color);
+                CHECK(light.radius == expected.radius);
+            }
+            if (after.hasComponent(HIERARCHY)) {
+                // Parents point at the loaded entities, not at the ids they had when written
+                const Entity::id_t parent = after.getComponent<HierarchyComponent>().getParent();
+                CHECK(loaded.isAlive(parent));
+                const float parentX = original.getComponent<TransformComponent>(
+                    before.getComponent<HierarchyComponent>().getParent()).getPosition().x;
+                CHECK(loaded.getComponent<TransformComponent>(parent).getPosition().x == parentX);
+            }
+        }
+    }
+
+    template<typename Func>
+    bool throws(Func &&func) {
+        try {
+            func();
+        } catch (const std::runtime_error &) {
+            return true;
+        } return false;
+    }
+
+    // A damaged file is rejected before any entity is added
+    void testCorrupted(const std::string &path) {
+        Registry original;
+        fill(original);
+        SceneSnapshot::write(original, path, NO_NAMES);
+        const auto size = std::filesystem::file_size(path);
+
+        Registry loaded;
+        std::filesystem::resize_file(path, size / 2);
+        CHECK(throws([&] { SceneSnapshot::load(loaded, path, NO_ASSETS); }));
+
+        SceneSnapshot::write(original, path, NO_NAMES);
+        {
+            std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+            file.write("XXXX", 4);
+        }
+        CHECK(throws([&] { SceneSnapshot::load(loaded, path, NO_ASSETS); }));
+        CHECK(loaded.size() == 0);
+    }
+}
+
+int main() {
+    const std::string path = (std::filesystem::temp_directory_path() / "snapshot_test.scene").string();
+    testRoundTrip(path);
+    testCorrupted(path);
+    std::filesystem::remove(path);
+    return EXIT_SUCCESS;
+}
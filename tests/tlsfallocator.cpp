@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "utils/memory/memoryallocator.hpp"
+
+using namespace Engine;
+
+namespace {
+    constexpr VkDeviceSize BLOCK_SIZE = VkDeviceSize{64} << 20;
+
+    struct Range {
+        uint32_t node;
+        VkDeviceSize offset, size;
+    };
+
+    // Every live range lies inside the block and overlaps no other
+    void checkDisjoint(std::vector<Range> ranges) {
+        std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b) { return a.offset < b.offset; });
+        for (size_t i = 0; i < ranges.size(); i++) {
+            CHECK(ranges[i].offset + ranges[i].size <= BLOCK_SIZE);
+            if (i > 0) CHECK(ranges[i - 1].offset + ranges[i - 1].size <= ranges[i].offset);
+        }
+    }
+
+    void testRounding() {
+        TlsfAllocator tlsf{BLOCK_SIZE};
+        CHECK(tlsf.empty() && tlsf.getFreeBytes() == BLOCK_SIZE && tlsf.getLargestFreeRange() == BLOCK_SIZE);
+
+        const uint32_t small = tlsf.allocate(1, 1);
+        CHECK(small != TlsfAllocator::INVALID_NODE);
+        CHECK(tlsf.getSize(small) == TlsfAllocator::MIN_ALIGNMENT);
+        CHECK(tlsf.getOffset(small) % TlsfAllocator::MIN_ALIGNMENT == 0);
+
+        const uint32_t aligned = tlsf.allocate(1000, 65536);
+        CHECK(aligned != TlsfAllocator::INVALID_NODE);
+        CHECK(tlsf.getOffset(aligned) % 65536 == 0);
+        CHECK(tlsf.getSize(aligned) == 1024);
+
+        CHECK(tlsf.getAllocationCount() == 2);
+        CHECK(tlsf.getUsedBytes() == TlsfAllocator::MIN_ALIGNMENT + 1024);
+        tlsf.free(small);
+        tlsf.free(aligned);
+        CHECK(tlsf.empty() && tlsf.getUsedBytes() == 0);
+    }
+
+    void testExhaustion() {
+        TlsfAllocator tlsf{BLOCK_SIZE};
+        CHECK(tlsf.allocate(BLOCK_SIZE + 1, 1) == TlsfAllocator::INVALID_NODE);
+
+        const uint32_t whole = tlsf.allocate(BLOCK_SIZE, 1);
+        CHECK(whole != TlsfAllocator::INVALID_NODE && tlsf.getOffset(whole) == 0);
+        CHECK(tlsf.getFreeBytes() == 0 && tlsf.getLargestFreeRange() == 0);
+        CHECK(tlsf.allocate(1, 1) == TlsfAllocator::INVALID_NODE);
+
+        tlsf.free(whole);
+        CHECK(tlsf.getLargestFreeRange() == BLOCK_SIZE);
+    }
+
+    // Freeing in any order merges the ranges back into one spanning the block
+    void testRandom() {
+        TlsfAllocator tlsf{BLOCK_SIZE};
+        std::mt19937 random{7};
+        std::uniform_int_distribution<VkDeviceSize> size{1, 1 << 20};
+        std::uniform_int_distribution<int> alignmentBit{0, 16};
+
+        std::vector<Range> live;
+        for (int round = 0; round < 20; round++) {
+            for (int i = 0; i < 200; i++) {
+                const VkDeviceSize alignment = VkDeviceSize{1} << alignmentBit(random);
+                const uint32_t node = tlsf.allocate(size(random), alignment);
+                if (node == TlsfAllocator::INVALID_NODE) break;
+                CHECK(tlsf.getOffset(node) % std::max(alignment, TlsfAllocator::MIN_ALIGNMENT) == 0);
+                live.push_back({node, tlsf.getOffset(node), tlsf.getSize(node)});
+            }
+            checkDisjoint(live);
+
+            VkDeviceSize used = 0;
+            for (const Range &range : live) used += range.size;
+            CHECK(tlsf.getUsedBytes() == used && tlsf.getAllocationCount() == live.size());
+
+            // Free about half, at random
+            std::shuffle(live.begin(), live.end(), random);
+            for (size_t i = live.size() / 2; i < live.size(); i++) tlsf.free(live[i].node);
+            live.resize(live.size() / 2);
+        }
+
+        for (const Range &range : live) tlsf.free(range.node);
+        CHECK(tlsf.empty() && tlsf.getUsedBytes() == 0);
+        CHECK(tlsf.getLargestFreeRange() == BLOCK_SIZE);
+    }
+}
+
+int main() {
+    testRounding();
+    testExhaustion();
+    testRandom();
+    return EXIT_SUCCESS;
+}